@@ -0,0 +1,469 @@
+// Connect Four solver: negamax with alpha-beta over the bitboard position in
+// connectFour.h, a transposition table, and a null-window search on the score.
+// Positions in the opening book are answered without searching. Also home to
+// the thread pool both Connect Four games split their root moves over.
+//
+// Scores are from the side to move: 0 is a draw, a win with the k-th stone of
+// the winner scores C4_CELLS / 2 + 1 - k (so sooner wins score higher) and a
+// loss the negative of that.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "connectFour.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define MIN_SCORE (-C4_CELLS / 2 + 3) // Nobody can win before their 4th stone
+#define MAX_SCORE ((C4_CELLS + 1) / 2 - 3)
+#define TT_SIZE 8388593 // Prime, so key % TT_SIZE spreads well; 64 MB
+#define DEADLINE_CHECK_NODES 4096 // Clock reads are far slower than nodes
+
+// Transposition table shared by every solver thread without locks. A slot is
+// one atomic word, key << 8 | value (the key is below 2^49), so a read can
+// never pair one position's key with another's value.
+static _Atomic uint64_t *ttSlots; // Value 0 = empty, else an upper or lower bound (see negamax)
+static pthread_once_t ttOnce = PTHREAD_ONCE_INIT;
+
+// Opening book, mapped read-only
+static void *bookData;
+static size_t bookBytes;
+static const uint64_t *bookEntries;
+static uint64_t bookCount;
+static int bookPlies = -1;
+
+// One search per thread; the threads of one solveMove2D share the stop flag
+struct SolverState {
+    long long nodes;
+    struct timespec deadline;
+    atomic_bool *stop; // Set by whichever thread first sees the deadline pass
+};
+static _Thread_local struct SolverState solver;
+static _Thread_local long long lastNodes; // For solverNodes2D
+
+// Thread pool: workers sleep on `wake` between batches of runParallel tasks
+static int searchThreadCount = 0; // 0 until set: one per core
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t idle; // Signalled when the last worker leaves a batch
+    int workers;
+    unsigned long batch; // Bumped for every runParallel call
+    void (*task)(void *context, int index);
+    void *context;
+    int count;
+    atomic_int next; // Next task index to hand out
+    int active;      // Workers inside the current batch
+} pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .idle = PTHREAD_COND_INITIALIZER};
+
+// --- Bitboard helpers ---
+
+// Cells, one per column, where the next stone would land
+static uint64_t possibleMoves(const struct Position2D *position) {
+    return (position->mask + bottomRow2D()) & boardMask2D();
+}
+
+static bool canWinNext(const struct Position2D *position) {
+    return winningCells2D(position->current, position->mask) & possibleMoves(position);
+}
+
+// Moves that don't hand the opponent an immediate win. Only valid when the side
+// to move can't win at once. 0 means every move loses.
+static uint64_t nonLosingMoves(const struct Position2D *position) {
+    uint64_t possible = possibleMoves(position);
+    uint64_t threats = winningCells2D(position->current ^ position->mask, position->mask);
+    uint64_t forced = possible & threats;
+    if (forced) {
+        if (forced & (forced - 1)) return 0; // Two threats at once: lost
+        possible = forced;                   // Must block
+    }
+    return possible & ~(threats >> 1); // Never play directly below an opponent's threat
+}
+
+static void playCell(struct Position2D *position, uint64_t cell) {
+    position->current ^= position->mask;
+    position->mask |= cell;
+    position->moves++;
+}
+
+// --- Transposition Table ---
+
+static void ttAllocate() {
+    ttSlots = calloc(TT_SIZE, sizeof(*ttSlots));
+}
+
+static bool ttInit() {
+    pthread_once(&ttOnce, ttAllocate);
+    return ttSlots != NULL;
+}
+
+static void ttPut(uint64_t key, int value) {
+    atomic_store_explicit(&ttSlots[key % TT_SIZE], key << 8 | (uint8_t)value, memory_order_relaxed);
+}
+
+static int ttGet(uint64_t key) {
+    uint64_t slot = atomic_load_explicit(&ttSlots[key % TT_SIZE], memory_order_relaxed);
+    return ((slot >> 8) == key) ? (int)(slot & 0xFF) : 0;
+}
+
+// --- Search ---
+
+static struct timespec deadlineAfter(int timeLimitMs) {
+    struct timespec deadline;
+    timespec_get(&deadline, TIME_UTC);
+    deadline.tv_sec += timeLimitMs / 1000;
+    deadline.tv_nsec += (long)(timeLimitMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+static bool pastDeadline() {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return now.tv_sec > solver.deadline.tv_sec ||
+           (now.tv_sec == solver.deadline.tv_sec && now.tv_nsec >= solver.deadline.tv_nsec);
+}
+
+static bool stopped() {
+    return atomic_load_explicit(solver.stop, memory_order_relaxed);
+}
+
+// Exact score if it lies in (alpha, beta); otherwise a bound on the same side of
+// the window. The side to move must not be able to win at once.
+static int negamax(const struct Position2D *position, int alpha, int beta) {
+    if ((++solver.nodes % DEADLINE_CHECK_NODES) == 0 && pastDeadline()) {
+        atomic_store_explicit(solver.stop, true, memory_order_relaxed);
+    }
+    if (stopped()) return 0;
+
+    uint64_t next = nonLosingMoves(position);
+    if (next == 0) return -(C4_CELLS - position->moves) / 2; // Opponent wins with their next stone
+    if (position->moves >= C4_CELLS - 2) return 0;           // Nobody can win in the last two moves
+
+    int min = -(C4_CELLS - 2 - position->moves) / 2; // The opponent can't win next move
+    if (alpha < min) {
+        alpha = min;
+        if (alpha >= beta) return alpha;
+    }
+    int max = (C4_CELLS - 1 - position->moves) / 2; // We can't win next move
+    uint64_t key = position->current + position->mask;
+    int stored = ttGet(key);
+    if (stored > MAX_SCORE - MIN_SCORE + 1) { // Lower bound
+        int lower = stored + 2 * MIN_SCORE - MAX_SCORE - 2;
+        if (alpha < lower) {
+            alpha = lower;
+            if (alpha >= beta) return alpha;
+        }
+    } else if (stored) { // Upper bound
+        max = stored + MIN_SCORE - 1;
+    }
+    if (beta > max) {
+        beta = max;
+        if (alpha >= beta) return beta;
+    }
+
+    // Order moves by how many winning cells they leave us; ties keep center-first order
+    uint64_t moves[C4_COLS];
+    int scores[C4_COLS];
+    int count = 0;
+    for (int i = 0; i < C4_COLS; i++) {
+        uint64_t cell = next & columnMask2D(centerOrder2D[i]);
+        if (!cell) continue;
+        int score = __builtin_popcountll(winningCells2D(position->current | cell, position->mask));
+        int j = count++;
+        for (; j > 0 && scores[j - 1] < score; j--) {
+            moves[j] = moves[j - 1];
+            scores[j] = scores[j - 1];
+        }
+        moves[j] = cell;
+        scores[j] = score;
+    }
+
+    for (int i = 0; i < count; i++) {
+        struct Position2D child = *position;
+        playCell(&child, moves[i]);
+        int score = -negamax(&child, -beta, -alpha);
+        if (stopped()) return 0;
+        if (score >= beta) {
+            ttPut(key, score + MAX_SCORE - 2 * MIN_SCORE + 2);
+            return score;
+        }
+        if (score > alpha) alpha = score;
+    }
+    ttPut(key, alpha - MIN_SCORE + 1);
+    return alpha;
+}
+
+// Score by repeated null-window searches that narrow [min, max], first clamped
+// to what the position allows. Probing 0 and half the remaining range first
+// settles win/draw/loss early. Exact if strictly inside the range; otherwise
+// a bound on the same side.
+static int solveWindow(const struct Position2D *position, int min, int max) {
+    if (canWinNext(position)) return (C4_CELLS + 1 - position->moves) / 2;
+    int score;
+    if (bookScore2D(position, &score)) return score;
+    int lowest = -(C4_CELLS - position->moves) / 2;
+    int highest = (C4_CELLS + 1 - position->moves) / 2;
+    if (min < lowest) min = lowest;
+    if (max > highest) max = highest;
+    while (min < max && !stopped()) {
+        int med = min + (max - min) / 2;
+        if (med <= 0 && min / 2 < med) med = min / 2;
+        else if (med >= 0 && max / 2 > med) med = max / 2;
+        int result = negamax(position, med, med + 1);
+        if (result <= med) max = result;
+        else min = result;
+    }
+    return min;
+}
+
+int solve2D(const struct Position2D *position, int timeLimitMs, bool *solved) {
+    *solved = false;
+    if (!ttInit()) return 0;
+    atomic_bool stop = false;
+    solver = (struct SolverState){0, deadlineAfter(timeLimitMs), &stop};
+    int score = solveWindow(position, -C4_CELLS, C4_CELLS);
+    lastNodes = solver.nodes;
+    *solved = !stop;
+    return *solved ? score : 0;
+}
+
+// Root moves of one solveMove2D, solved in parallel. Each thread only asks
+// whether its move beats the best score so far, so later moves mostly fail low fast.
+struct RootSolve {
+    struct Position2D position;
+    int columns[C4_COLS];
+    int scores[C4_COLS];
+    bool exact[C4_COLS]; // The score beat the alpha its search started with
+    atomic_int alpha;    // Best exact score so far
+    atomic_bool stop;
+    struct timespec deadline;
+    _Atomic long long nodes;
+};
+
+static void solveRootMove(void *context, int index) {
+    struct RootSolve *root = context;
+    solver = (struct SolverState){0, root->deadline, &root->stop};
+    struct Position2D child = root->position;
+    play2D(&child, root->columns[index]);
+
+    int alpha = atomic_load_explicit(&root->alpha, memory_order_relaxed);
+    int score = -solveWindow(&child, -C4_CELLS, -alpha);
+    root->scores[index] = score;
+    root->exact[index] = score > alpha;
+    while (score > alpha && !atomic_compare_exchange_weak(&root->alpha, &alpha, score)) {
+    }
+    atomic_fetch_add(&root->nodes, solver.nodes);
+}
+
+int solveMove2D(const struct Position2D *position, int timeLimitMs, int *score) {
+    if (position->moves >= C4_CELLS || !ttInit()) return -1;
+    lastNodes = 0;
+
+    uint64_t wins = winningCells2D(position->current, position->mask) & possibleMoves(position);
+    for (int i = 0; i < C4_COLS; i++) {
+        int col = centerOrder2D[i];
+        if (wins & columnMask2D(col)) {
+            *score = (C4_CELLS + 1 - position->moves) / 2;
+            return col;
+        }
+    }
+
+    struct RootSolve root = {.position = *position, .alpha = -C4_CELLS, .deadline = deadlineAfter(timeLimitMs)};
+    int count = 0;
+    for (int i = 0; i < C4_COLS; i++) {
+        if (canPlay2D(position, centerOrder2D[i])) root.columns[count++] = centerOrder2D[i];
+    }
+    runParallel(count, solveRootMove, &root);
+    lastNodes = root.nodes;
+    if (root.stop) return -1;
+
+    int best = -1;
+    for (int i = 0; i < count; i++) { // Ties go to the more central column
+        if (root.exact[i] && (best == -1 || root.scores[i] > root.scores[best])) best = i;
+    }
+    *score = root.scores[best];
+    return root.columns[best];
+}
+
+long long solverNodes2D() {
+    return lastNodes;
+}
+
+// --- Threads ---
+
+static int countCores() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+#endif
+}
+
+void setSearchThreads(int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_SEARCH_THREADS) count = MAX_SEARCH_THREADS;
+    searchThreadCount = count;
+}
+
+int getSearchThreads() {
+    if (searchThreadCount == 0) setSearchThreads(countCores());
+    return searchThreadCount;
+}
+
+static void runTasks(void (*task)(void *context, int index), void *context, int count) {
+    for (int i; (i = atomic_fetch_add(&pool.next, 1)) < count;) task(context, i);
+}
+
+static void *poolWorker(void *arg) {
+    (void)arg;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (pool.batch == seen) pthread_cond_wait(&pool.wake, &pool.lock);
+        seen = pool.batch;
+        void (*task)(void *, int) = pool.task;
+        void *context = pool.context;
+        int count = pool.count;
+        pool.active++;
+        pthread_mutex_unlock(&pool.lock);
+
+        runTasks(task, context, count);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.active == 0) pthread_cond_broadcast(&pool.idle);
+    }
+    return NULL;
+}
+
+// Workers are started on first use and kept. The calling thread takes tasks
+// too. A new batch waits for stragglers from the last one, so a worker that
+// woke late can't take an index of the new batch with the old task.
+void runParallel(int count, void (*task)(void *context, int index), void *context) {
+    int threads = getSearchThreads();
+    pthread_mutex_lock(&pool.lock);
+    while (pool.workers < threads - 1) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, poolWorker, NULL) != 0) break; // Run with fewer
+        pthread_detach(thread);
+        pool.workers++;
+    }
+    while (pool.active > 0) pthread_cond_wait(&pool.idle, &pool.lock);
+    pool.task = task;
+    pool.context = context;
+    pool.count = count;
+    atomic_store(&pool.next, 0);
+    pool.batch++;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    runTasks(task, context, count);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.active > 0) pthread_cond_wait(&pool.idle, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+// --- Opening Book ---
+
+static void *mapFile(const char *path, size_t *bytes) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    LARGE_INTEGER size;
+    void *data = NULL;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping); // The view keeps the mapping alive
+        }
+        *bytes = (size_t)size.QuadPart;
+    }
+    CloseHandle(file);
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat info;
+    void *data = NULL;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) data = NULL;
+        *bytes = (size_t)info.st_size;
+    }
+    close(fd);
+    return data;
+#endif
+}
+
+static void unmapFile(void *data, size_t bytes) {
+#ifdef _WIN32
+    (void)bytes;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, bytes);
+#endif
+}
+
+bool openBook2D(const char *path) {
+    closeBook2D();
+    size_t bytes = 0;
+    void *data = mapFile(path, &bytes);
+    if (!data) return false;
+
+    const struct BookHeader2D *header = data;
+    if (bytes < sizeof(*header) || memcmp(header->magic, BOOK_MAGIC, 4) != 0 || header->version != BOOK_VERSION ||
+        header->count != (bytes - sizeof(*header)) / sizeof(uint64_t) ||
+        (bytes - sizeof(*header)) % sizeof(uint64_t) != 0) {
+        unmapFile(data, bytes);
+        return false;
+    }
+    bookData = data;
+    bookBytes = bytes;
+    bookEntries = (const uint64_t *)(header + 1);
+    bookCount = header->count;
+    bookPlies = header->plies;
+    return true;
+}
+
+void closeBook2D() {
+    if (bookData) unmapFile(bookData, bookBytes);
+    bookData = NULL;
+    bookEntries = NULL;
+    bookCount = 0;
+    bookPlies = -1;
+}
+
+int bookPlies2D() {
+    return bookPlies;
+}
+
+bool bookScore2D(const struct Position2D *position, int *score) {
+    if (position->moves > bookPlies) return false;
+    uint64_t key = canonicalKey2D(position);
+    uint64_t low = 0, high = bookCount;
+    while (low < high) { // First entry whose key is >= key
+        uint64_t middle = low + (high - low) / 2;
+        if ((bookEntries[middle] >> 8) < key) low = middle + 1;
+        else high = middle;
+    }
+    if (low == bookCount || (bookEntries[low] >> 8) != key) return false;
+    *score = (int8_t)(bookEntries[low] & 0xFF);
+    return true;
+}
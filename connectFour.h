@@ -0,0 +1,194 @@
+#ifndef CONNECT_FOUR_H
+#define CONNECT_FOUR_H
+
+// Bitboard Connect Four position (7 columns x 6 rows), used by twoDConnectFour.c,
+// and the perfect-play solver, opening book and search threads in connectFour.c.
+//
+// Build:
+//   gcc twoDConnectFour.c connectFour.c -Iinclude -Llib -lraylib -lopengl32 -lgdi32 -lwinmm -lpthread -o twoDConnectFour.exe
+//   gcc connectFourBook.c connectFour.c -lpthread -o connectFourBook.exe
+//
+// Each column takes C4_ROWS + 1 bits, bottom row first:
+//
+//    6 13 20 27 34 41 48   <- spare bit, always 0
+//    5 12 19 26 33 40 47
+//    4 11 18 25 32 39 46
+//    3 10 17 24 31 38 45
+//    2  9 16 23 30 37 44
+//    1  8 15 22 29 36 43
+//    0  7 14 21 28 35 42
+//
+// The spare bit stops a shift from carrying one column into the next, so
+// four in a row in any direction is two shifts and ANDs. A position is the
+// stones of the side to move plus a mask of all stones; the first player
+// moves when `moves` is even.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define C4_ROWS 6
+#define C4_COLS 7
+#define C4_COLUMN_BITS (C4_ROWS + 1)
+#define C4_CELLS (C4_ROWS * C4_COLS)
+
+// Columns nearest the center take part in the most lines, so searches try them first
+static const int centerOrder2D[C4_COLS] = {3, 2, 4, 1, 5, 0, 6};
+
+struct Position2D {
+    uint64_t current; // Stones of the side to move
+    uint64_t mask;    // Every stone on the board
+    int moves;        // Stones played so far
+};
+
+static inline uint64_t bottomMask2D(int col) {
+    return 1ULL << (col * C4_COLUMN_BITS);
+}
+
+static inline uint64_t topMask2D(int col) {
+    return 1ULL << (C4_ROWS - 1 + col * C4_COLUMN_BITS);
+}
+
+static inline uint64_t columnMask2D(int col) {
+    return ((1ULL << C4_ROWS) - 1) << (col * C4_COLUMN_BITS);
+}
+
+// Bit of the cell, row 0 being the bottom row
+static inline uint64_t cellMask2D(int row, int col) {
+    return 1ULL << (col * C4_COLUMN_BITS + row);
+}
+
+static inline bool canPlay2D(const struct Position2D *position, int col) {
+    return (position->mask & topMask2D(col)) == 0;
+}
+
+// Drops a stone for the side to move; adding the column's bottom bit to the
+// mask carries into the lowest empty cell
+static inline void play2D(struct Position2D *position, int col) {
+    position->current ^= position->mask;
+    position->mask |= position->mask + bottomMask2D(col);
+    position->moves++;
+}
+
+// Takes back the top stone of `col`, which must be the last move played
+static inline void undo2D(struct Position2D *position, int col) {
+    uint64_t top = ((position->mask & columnMask2D(col)) + bottomMask2D(col)) >> 1;
+    position->mask ^= top;
+    position->current ^= position->mask;
+    position->moves--;
+}
+
+// True if `stones` contain four in a row: horizontal, vertical or either diagonal
+static inline bool alignment2D(uint64_t stones) {
+    static const int shifts[4] = {C4_COLUMN_BITS, 1, C4_COLUMN_BITS - 1, C4_COLUMN_BITS + 1};
+    for (int i = 0; i < 4; i++) {
+        uint64_t pairs = stones & (stones >> shifts[i]);
+        if (pairs & (pairs >> (2 * shifts[i]))) return true;
+    }
+    return false;
+}
+
+// Stones of the player who moves first (even moves) or second (odd moves)
+static inline uint64_t stonesOf2D(const struct Position2D *position, bool firstPlayer) {
+    bool firstToMove = (position->moves & 1) == 0;
+    return (firstPlayer == firstToMove) ? position->current : position->current ^ position->mask;
+}
+
+static inline uint64_t bottomRow2D() {
+    uint64_t row = 0;
+    for (int col = 0; col < C4_COLS; col++) row |= bottomMask2D(col);
+    return row;
+}
+
+// Every cell of the board, spare bits excluded
+static inline uint64_t boardMask2D() {
+    return bottomRow2D() * ((1ULL << C4_ROWS) - 1);
+}
+
+// Empty cells that would complete four in a row for `stones`
+static inline uint64_t winningCells2D(uint64_t stones, uint64_t mask) {
+    // Vertical: three stacked stones
+    uint64_t cells = (stones << 1) & (stones << 2) & (stones << 3);
+
+    static const int shifts[3] = {C4_COLUMN_BITS, C4_COLUMN_BITS - 1, C4_COLUMN_BITS + 1};
+    for (int i = 0; i < 3; i++) {
+        int s = shifts[i];
+        uint64_t pairs = (stones << s) & (stones << 2 * s);
+        cells |= pairs & (stones << 3 * s); // xxx.
+        cells |= pairs & (stones >> s);     // xx.x
+        pairs = (stones >> s) & (stones >> 2 * s);
+        cells |= pairs & (stones << s);     // x.xx
+        cells |= pairs & (stones >> 3 * s); // .xxx
+    }
+    return cells & (boardMask2D() ^ mask);
+}
+
+// Unique per position: current + mask never carries out of a column
+static inline uint64_t positionKey2D(const struct Position2D *position) {
+    return position->current + position->mask;
+}
+
+// Key of the left-right mirror image
+static inline uint64_t mirrorKey2D(uint64_t key) {
+    uint64_t mirrored = 0;
+    for (int col = 0; col < C4_COLS; col++) {
+        uint64_t column = (key >> (col * C4_COLUMN_BITS)) & ((1ULL << C4_COLUMN_BITS) - 1);
+        mirrored |= column << ((C4_COLS - 1 - col) * C4_COLUMN_BITS);
+    }
+    return mirrored;
+}
+
+// Same key for a position and its mirror image
+static inline uint64_t canonicalKey2D(const struct Position2D *position) {
+    uint64_t key = positionKey2D(position);
+    uint64_t mirrored = mirrorKey2D(key);
+    return (mirrored < key) ? mirrored : key;
+}
+
+// --- Solver (connectFour.c) ---
+// Scores are from the side to move: 0 draw, positive a win (higher = sooner),
+// negative a loss. One lock-free transposition table (64 MB, allocated on
+// first use) is shared by every thread and kept across calls.
+
+// Exact score of the position, searched on the calling thread; safe to call
+// from several threads at once. *solved is false if the time ran out first.
+int solve2D(const struct Position2D *position, int timeLimitMs, bool *solved);
+// Column with the best exact score, its moves solved in parallel (see
+// runParallel), or -1 if the time ran out first
+int solveMove2D(const struct Position2D *position, int timeLimitMs, int *score);
+long long solverNodes2D(); // Nodes searched by this thread's last solve2D/solveMove2D
+
+// --- Opening Book (connectFour.c, written by connectFourBook.c) ---
+// Exact scores of every position up to `plies` stones, mirror images folded
+// together. Positions where the side to move wins at once are left out; the
+// solver sees those immediately. The file is a BookHeader2D followed by
+// `count` uint64 entries, canonicalKey2D << 8 | (uint8_t)score, sorted
+// ascending, all little-endian. It is memory-mapped, not read.
+#define BOOK_MAGIC "C4BK"
+#define BOOK_VERSION 1
+#define BOOK_DEFAULT_FILE "connectFour.book"
+
+struct BookHeader2D {
+    char magic[4];
+    uint8_t version;
+    uint8_t plies;
+    uint8_t reserved[2];
+    uint64_t count;
+};
+
+bool openBook2D(const char *path); // Replaces any open book; false if missing or malformed
+void closeBook2D();
+int bookPlies2D(); // Deepest position in the open book, -1 without one
+bool bookScore2D(const struct Position2D *position, int *score); // solve2D/solveMove2D look here first
+
+// --- Threads (connectFour.c) ---
+// A pool of worker threads, started on first use, shared by the 2D and 3D
+// games, the solver and the book builder.
+#define MAX_SEARCH_THREADS 64
+
+void setSearchThreads(int count); // Clamped to 1..MAX_SEARCH_THREADS
+int getSearchThreads();           // One per core until set
+// Calls task(context, i) for every i in [0, count) across the pool, the
+// calling thread included, in roughly ascending order; returns when all are done
+void runParallel(int count, void (*task)(void *context, int index), void *context);
+
+#endif // CONNECT_FOUR_H
@@ -0,0 +1,211 @@
+// Builds the Connect Four opening book read by connectFour.c: the exact score
+// of every position up to a number of plies.
+//
+// Usage: connectFourBook [plies] [output]   (defaults: 8, connectFour.book)
+//
+// Positions are collected one ply at a time, mirror images folded together.
+// Only the deepest ply is solved; every shallower score follows from its
+// children's. That still leaves the solver doing nearly all the work: about
+// a second per position at ply 8, so 8 plies take a day on one core. The
+// positions of that ply are spread over every core (see runParallel).
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "connectFour.h"
+
+#define MAX_BOOK_PLIES 16
+#define PROGRESS_INTERVAL 256
+
+struct BookPosition {
+    uint64_t key; // canonicalKey2D
+    struct Position2D position;
+    int score;
+};
+
+// All positions with the same number of stones, sorted by key
+struct Level {
+    struct BookPosition *positions;
+    size_t count;
+};
+
+static int compareKeys(const void *a, const void *b) {
+    uint64_t x = ((const struct BookPosition *)a)->key;
+    uint64_t y = ((const struct BookPosition *)b)->key;
+    return (x > y) - (x < y);
+}
+
+static int compareEntries(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double msSince(struct timespec start) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+// True if the side to move completes four in a row by playing `col`
+static bool winsAt(const struct Position2D *position, int col) {
+    struct Position2D child = *position;
+    play2D(&child, col);
+    return alignment2D(child.current ^ child.mask);
+}
+
+static bool canWinNow(const struct Position2D *position) {
+    for (int col = 0; col < C4_COLS; col++) {
+        if (canPlay2D(position, col) && winsAt(position, col)) return true;
+    }
+    return false;
+}
+
+static const struct BookPosition *findPosition(const struct Level *level, uint64_t key) {
+    struct BookPosition probe = {.key = key};
+    return bsearch(&probe, level->positions, level->count, sizeof(probe), compareKeys);
+}
+
+// Every unfinished position one stone deeper than `parent`, each once
+static bool expandLevel(const struct Level *parent, struct Level *child) {
+    child->positions = malloc((parent->count * C4_COLS + 1) * sizeof(*child->positions));
+    child->count = 0;
+    if (!child->positions) return false;
+    for (size_t i = 0; i < parent->count; i++) {
+        const struct Position2D *position = &parent->positions[i].position;
+        for (int col = 0; col < C4_COLS; col++) {
+            if (!canPlay2D(position, col) || winsAt(position, col)) continue;
+            struct BookPosition *next = &child->positions[child->count++];
+            next->position = *position;
+            play2D(&next->position, col);
+            next->key = canonicalKey2D(&next->position);
+            next->score = 0;
+        }
+    }
+    qsort(child->positions, child->count, sizeof(*child->positions), compareKeys);
+    size_t unique = 0;
+    for (size_t i = 0; i < child->count; i++) {
+        if (unique == 0 || child->positions[i].key != child->positions[unique - 1].key) {
+            child->positions[unique++] = child->positions[i];
+        }
+    }
+    child->count = unique;
+    return true;
+}
+
+struct LevelSolve {
+    struct Level *level;
+    struct timespec start;
+    atomic_size_t done;
+};
+
+static void solvePosition(void *context, int index) {
+    struct LevelSolve *work = context;
+    struct Level *level = work->level;
+    bool solved;
+    level->positions[index].score = solve2D(&level->positions[index].position, 0x7FFFFFFF, &solved);
+    size_t done = atomic_fetch_add(&work->done, 1) + 1;
+    if (done % PROGRESS_INTERVAL == 0 || done == level->count) {
+        double elapsed = msSince(work->start) / 1000.0;
+        fprintf(stderr, "\rsolved %zu / %zu positions, %.0f s, about %.0f s left   ", done, level->count, elapsed,
+                elapsed / done * (level->count - done));
+    }
+}
+
+static void solveLevel(struct Level *level) {
+    struct LevelSolve work = {.level = level, .done = 0};
+    timespec_get(&work.start, TIME_UTC);
+    printf("solving on %d threads\n", getSearchThreads());
+    runParallel((int)level->count, solvePosition, &work);
+    fprintf(stderr, "\n");
+}
+
+// Negamax over the children, which are already scored
+static void scoreFromChildren(struct Level *level, const struct Level *children) {
+    for (size_t i = 0; i < level->count; i++) {
+        const struct Position2D *position = &level->positions[i].position;
+        int best = -C4_CELLS;
+        for (int col = 0; col < C4_COLS; col++) {
+            if (!canPlay2D(position, col)) continue;
+            if (winsAt(position, col)) {
+                best = (C4_CELLS + 1 - position->moves) / 2;
+                break;
+            }
+            struct Position2D child = *position;
+            play2D(&child, col);
+            int score = -findPosition(children, canonicalKey2D(&child))->score;
+            if (score > best) best = score;
+        }
+        level->positions[i].score = best;
+    }
+}
+
+static bool writeBook(const struct Level levels[], int levelCount, int plies, const char *path) {
+    size_t total = 0;
+    for (int i = 0; i < levelCount; i++) total += levels[i].count;
+    uint64_t *entries = malloc((total + 1) * sizeof(*entries));
+    if (!entries) return false;
+
+    size_t count = 0;
+    for (int i = 0; i < levelCount; i++) {
+        for (size_t j = 0; j < levels[i].count; j++) {
+            const struct BookPosition *entry = &levels[i].positions[j];
+            if (canWinNow(&entry->position)) continue; // The solver sees these at once
+            entries[count++] = entry->key << 8 | (uint8_t)(int8_t)entry->score;
+        }
+    }
+    qsort(entries, count, sizeof(*entries), compareEntries);
+
+    struct BookHeader2D header = {.version = BOOK_VERSION, .plies = (uint8_t)plies, .count = count};
+    memcpy(header.magic, BOOK_MAGIC, 4);
+    FILE *file = fopen(path, "wb");
+    bool ok = file && fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(entries, sizeof(*entries), count, file) == count;
+    if (file && fclose(file) != 0) ok = false;
+    if (ok) printf("%zu positions, %zu bytes written to %s\n", count, sizeof(header) + count * sizeof(*entries), path);
+    free(entries);
+    return ok;
+}
+
+// Book of every position from `root` down to `plies` stones in total
+static bool buildBook(const struct Position2D *root, int plies, const char *path) {
+    struct Level levels[MAX_BOOK_PLIES + 1] = {0};
+    int levelCount = plies - root->moves + 1;
+    bool ok = true;
+
+    levels[0].positions = malloc(sizeof(*levels[0].positions));
+    ok = levels[0].positions != NULL;
+    if (ok) {
+        levels[0].positions[0] = (struct BookPosition){canonicalKey2D(root), *root, 0};
+        levels[0].count = 1;
+    }
+    for (int i = 1; ok && i < levelCount; i++) {
+        ok = expandLevel(&levels[i - 1], &levels[i]);
+        if (ok) printf("ply %d: %zu positions\n", root->moves + i, levels[i].count);
+    }
+    if (ok) {
+        solveLevel(&levels[levelCount - 1]);
+        for (int i = levelCount - 2; i >= 0; i--) scoreFromChildren(&levels[i], &levels[i + 1]);
+        ok = writeBook(levels, levelCount, plies, path);
+    }
+    for (int i = 0; i < levelCount; i++) free(levels[i].positions);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int plies = (argc > 1) ? atoi(argv[1]) : 8;
+    const char *path = (argc > 2) ? argv[2] : BOOK_DEFAULT_FILE;
+    if (plies < 0 || plies > MAX_BOOK_PLIES) {
+        fprintf(stderr, "Usage: connectFourBook [plies 0-%d] [output]\n", MAX_BOOK_PLIES);
+        return 1;
+    }
+
+    struct Position2D empty = {0};
+    if (!buildBook(&empty, plies, path)) {
+        fprintf(stderr, "Could not build %s\n", path);
+        return 1;
+    }
+    return 0;
+}
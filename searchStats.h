@@ -0,0 +1,126 @@
+#ifndef SEARCH_STATS_H
+#define SEARCH_STATS_H
+
+// Opt-in search instrumentation shared by the chess engines.
+//
+// Build with -DSEARCH_STATS to enable it. Without it every STATS_* macro
+// expands to nothing, so the search pays nothing for the hooks.
+//
+// Counters are kept per iterative-deepening iteration (per root depth) and
+// one JSON line is written to stderr at the end of each search:
+//   {"search":"2d-chess","depth":4,"nodes":...,"iterations":[{"depth":1,...},...]}
+
+#ifdef SEARCH_STATS
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define STATS_MAX_ITERATIONS 64
+
+struct IterationStats {
+    int depth;
+    long long nodes;              // Interior and leaf nodes of the main search
+    long long qnodes;             // Quiescence search nodes
+    long long tt_probes;
+    long long tt_hits;            // Probes that found the position
+    long long tt_cuts;            // Hits whose stored bound ended the node
+    long long beta_cutoffs;
+    long long first_move_cutoffs; // Cutoffs produced by the first move searched
+    double time_ms;
+};
+
+struct SearchStats {
+    struct IterationStats iterations[STATS_MAX_ITERATIONS];
+    int iteration_count;
+    struct IterationStats *current; // Iteration being counted
+    struct timespec search_start;
+    struct timespec iteration_start;
+};
+
+// One search per thread at a time
+static _Thread_local struct SearchStats search_stats;
+static _Thread_local struct IterationStats stats_discard; // Counts outside any iteration
+
+static double stats_ms_since(struct timespec start) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+static void stats_begin_search() {
+    memset(&search_stats, 0, sizeof(search_stats));
+    search_stats.current = &stats_discard;
+    timespec_get(&search_stats.search_start, TIME_UTC);
+}
+
+static void stats_begin_iteration(int depth) {
+    if (search_stats.iteration_count >= STATS_MAX_ITERATIONS) return;
+    search_stats.current = &search_stats.iterations[search_stats.iteration_count++];
+    search_stats.current->depth = depth;
+    timespec_get(&search_stats.iteration_start, TIME_UTC);
+}
+
+static void stats_end_iteration() {
+    search_stats.current->time_ms = stats_ms_since(search_stats.iteration_start);
+    search_stats.current = &stats_discard;
+}
+
+// Writes the whole search as a single JSON line so concurrent searches don't interleave
+static void stats_dump_json(FILE *stream, const char *label) {
+    char buffer[16384];
+    int len = 0;
+    long long total_nodes = 0;
+    int completed_depth = 0;
+    for (int i = 0; i < search_stats.iteration_count; i++) {
+        total_nodes += search_stats.iterations[i].nodes + search_stats.iterations[i].qnodes;
+        completed_depth = search_stats.iterations[i].depth;
+    }
+    double total_ms = stats_ms_since(search_stats.search_start);
+
+    len += snprintf(buffer + len, sizeof(buffer) - len,
+                    "{\"search\":\"%s\",\"depth\":%d,\"nodes\":%lld,\"time_ms\":%.3f,\"nps\":%.0f,\"iterations\":[",
+                    label, completed_depth, total_nodes, total_ms,
+                    total_ms > 0.0 ? total_nodes * 1000.0 / total_ms : 0.0);
+    for (int i = 0; i < search_stats.iteration_count && len < (int)sizeof(buffer) - 512; i++) {
+        const struct IterationStats *it = &search_stats.iterations[i];
+        long long nodes = it->nodes + it->qnodes;
+        long long previous = (i > 0) ? search_stats.iterations[i - 1].nodes + search_stats.iterations[i - 1].qnodes : 0;
+        len += snprintf(buffer + len, sizeof(buffer) - len,
+                        "%s{\"depth\":%d,\"nodes\":%lld,\"qnodes\":%lld,\"tt_probes\":%lld,\"tt_hits\":%lld,"
+                        "\"tt_cuts\":%lld,\"beta_cutoffs\":%lld,\"first_move_cutoff_rate\":%.4f,"
+                        "\"ebf\":%.3f,\"time_ms\":%.3f,\"nps\":%.0f}",
+                        i > 0 ? "," : "", it->depth, it->nodes, it->qnodes, it->tt_probes, it->tt_hits,
+                        it->tt_cuts, it->beta_cutoffs,
+                        it->beta_cutoffs > 0 ? (double)it->first_move_cutoffs / it->beta_cutoffs : 0.0,
+                        previous > 0 ? (double)nodes / previous : 0.0,
+                        it->time_ms, it->time_ms > 0.0 ? nodes * 1000.0 / it->time_ms : 0.0);
+    }
+    snprintf(buffer + len, sizeof(buffer) - len, "]}\n");
+    fputs(buffer, stream);
+    fflush(stream);
+}
+
+#define STATS_BEGIN_SEARCH() stats_begin_search()
+#define STATS_BEGIN_ITERATION(depth) stats_begin_iteration(depth)
+#define STATS_END_ITERATION() stats_end_iteration()
+#define STATS_INC(field) (search_stats.current->field++)
+#define STATS_CUTOFF(move_index) \
+    do { \
+        search_stats.current->beta_cutoffs++; \
+        if ((move_index) == 0) search_stats.current->first_move_cutoffs++; \
+    } while (0)
+#define STATS_DUMP(label) stats_dump_json(stderr, label)
+
+#else
+
+#define STATS_BEGIN_SEARCH() ((void)0)
+#define STATS_BEGIN_ITERATION(depth) ((void)0)
+#define STATS_END_ITERATION() ((void)0)
+#define STATS_INC(field) ((void)0)
+#define STATS_CUTOFF(move_index) ((void)0)
+#define STATS_DUMP(label) ((void)0)
+
+#endif // SEARCH_STATS
+
+#endif // SEARCH_STATS_H
@@ -0,0 +1,1765 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "threeDChessEngine.h"
+#include "searchStats.h" // Opt-in node counters (-DSEARCH_STATS)
+
+// --- Precomputed Attack Tables ---
+// Built once by init_attack_tables(). Moves within a layer come from 64-bit masks
+// (bit = row * 8 + col); moves that change layer use the precomputed ray lists,
+// which are at most two squares long on a three-layer board.
+
+static unsigned char ray_squares[NUM_SQUARES][NUM_DIRECTIONS][BOARD_SIZE - 1]; // Squares along each ray, nearest first
+static unsigned char ray_length[NUM_SQUARES][NUM_DIRECTIONS];
+static bool direction_is_diagonal[NUM_DIRECTIONS]; // Bishop-like; all other directions are rook-like
+static uint64_t line_mask[BOARD_SQUARES][FLAT_DIRECTIONS]; // In-layer rays, origin excluded
+static uint64_t knight_mask[BOARD_SQUARES]; // Same mask is used on the adjacent layers
+static uint64_t king_mask[BOARD_SQUARES];   // Neighbours within the layer
+static uint64_t pawn_attack_mask[2][BOARD_SQUARES]; // [pawn color][from]: diagonal forward squares
+static bool attack_tables_ready = false;
+
+#define CENTER_MASK 0x00003C3C3C3C0000ULL // Rows and columns 2..5
+
+static int square_index(int layer, int row, int col) {
+    return (layer * BOARD_SIZE + row) * BOARD_SIZE + col;
+}
+
+static const struct Square *square_at(const struct Board *board, int sq) {
+    return &board->squares[0][0][0] + sq;
+}
+
+// Removes and returns the lowest set bit
+static int pop_lsb(uint64_t *bitboard) {
+    int bit = __builtin_ctzll(*bitboard);
+    *bitboard &= *bitboard - 1;
+    return bit;
+}
+
+// Directions 0, 2, 4 and 5 move towards higher bit indices
+static uint64_t ray_attacks(int from, int direction, uint64_t occupied) {
+    uint64_t ray = line_mask[from][direction];
+    uint64_t blockers = ray & occupied;
+    if (blockers == 0) return ray;
+    bool increasing = (direction == 0 || direction == 2 || direction == 4 || direction == 5);
+    int first = increasing ? __builtin_ctzll(blockers) : 63 - __builtin_clzll(blockers);
+    return ray ^ line_mask[first][direction]; // Keep the blocker, drop everything behind it
+}
+
+static uint64_t rook_attacks(int from, uint64_t occupied) {
+    return ray_attacks(from, 0, occupied) | ray_attacks(from, 1, occupied) |
+           ray_attacks(from, 2, occupied) | ray_attacks(from, 3, occupied);
+}
+
+static uint64_t bishop_attacks(int from, uint64_t occupied) {
+    return ray_attacks(from, 4, occupied) | ray_attacks(from, 5, occupied) |
+           ray_attacks(from, 6, occupied) | ray_attacks(from, 7, occupied);
+}
+
+static uint64_t layer_occupancy(const struct Board *board, int layer) {
+    return board->color_bb[P_WHITE][layer] | board->color_bb[P_BLACK][layer];
+}
+
+static void init_attack_tables(void) {
+    if (attack_tables_ready) return;
+
+    // Same direction order as the old per-call table in is_square_attacked
+    int directions[NUM_DIRECTIONS][3];
+    int dir_count = 0;
+    int flat[FLAT_DIRECTIONS][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    for (int i = 0; i < FLAT_DIRECTIONS; i++) {
+        directions[dir_count][0] = 0; directions[dir_count][1] = flat[i][0]; directions[dir_count][2] = flat[i][1]; dir_count++;
+    }
+    for (int l_change = -1; l_change <= 1; l_change += 2) {
+        directions[dir_count][0] = l_change; directions[dir_count][1] = 0; directions[dir_count][2] = 0; dir_count++; // Straight up/down
+        for (int i = 0; i < FLAT_DIRECTIONS; i++) {
+            directions[dir_count][0] = l_change; directions[dir_count][1] = flat[i][0]; directions[dir_count][2] = flat[i][1]; dir_count++;
+        }
+    }
+    for (int d = 0; d < NUM_DIRECTIONS; d++) {
+        direction_is_diagonal[d] = (directions[d][1] != 0 && directions[d][2] != 0);
+    }
+
+    for (int layer = 0; layer < BOARD_LAYERS; layer++) {
+        for (int row = 0; row < BOARD_SIZE; row++) {
+            for (int col = 0; col < BOARD_SIZE; col++) {
+                int sq = square_index(layer, row, col);
+                for (int d = 0; d < NUM_DIRECTIONS; d++) {
+                    int l = layer + directions[d][0], r = row + directions[d][1], c = col + directions[d][2];
+                    ray_length[sq][d] = 0;
+                    while (is_valid_position(l, r, c)) {
+                        ray_squares[sq][d][ray_length[sq][d]++] = square_index(l, r, c);
+                        l += directions[d][0]; r += directions[d][1]; c += directions[d][2];
+                    }
+                }
+            }
+        }
+    }
+
+    int knight_moves[8][2] = {{2, 1}, {2, -1}, {-2, 1}, {-2, -1}, {1, 2}, {1, -2}, {-1, 2}, {-1, -2}};
+
+    for (int row = 0; row < BOARD_SIZE; row++) {
+        for (int col = 0; col < BOARD_SIZE; col++) {
+            int from = row * BOARD_SIZE + col;
+
+            for (int d = 0; d < FLAT_DIRECTIONS; d++) {
+                line_mask[from][d] = 0;
+                for (int r = row + flat[d][0], c = col + flat[d][1]; is_valid_position(0, r, c); r += flat[d][0], c += flat[d][1]) {
+                    line_mask[from][d] |= SQUARE_BIT(r, c);
+                }
+            }
+
+            knight_mask[from] = 0;
+            for (int i = 0; i < 8; i++) {
+                int r = row + knight_moves[i][0], c = col + knight_moves[i][1];
+                if (is_valid_position(0, r, c)) knight_mask[from] |= SQUARE_BIT(r, c);
+            }
+
+            king_mask[from] = 0;
+            for (int d = 0; d < FLAT_DIRECTIONS; d++) {
+                int r = row + flat[d][0], c = col + flat[d][1];
+                if (is_valid_position(0, r, c)) king_mask[from] |= SQUARE_BIT(r, c);
+            }
+
+            // A pawn attacks diagonally forward; the same mask applies on the adjacent layers
+            for (int color = P_WHITE; color <= P_BLACK; color++) {
+                int r = row + ((color == P_WHITE) ? -1 : 1);
+                pawn_attack_mask[color][from] = 0;
+                if (is_valid_position(0, r, col - 1)) pawn_attack_mask[color][from] |= SQUARE_BIT(r, col - 1);
+                if (is_valid_position(0, r, col + 1)) pawn_attack_mask[color][from] |= SQUARE_BIT(r, col + 1);
+            }
+        }
+    }
+    attack_tables_ready = true;
+}
+
+// Adds a move to every square in `targets` (a mask on to_layer)
+static void add_target_moves(const struct Board *board, int layer, int row, int col, int to_layer, uint64_t targets, struct Move moves[], int *move_count) {
+    enum PieceColor opponent_color = (board->squares[layer][row][col].color == P_WHITE) ? P_BLACK : P_WHITE;
+    while (targets) {
+        int to = pop_lsb(&targets);
+        bool is_capture = (board->color_bb[opponent_color][to_layer] >> to) & 1;
+        moves[*move_count] = (struct Move){layer, row, col, to_layer, to / BOARD_SIZE, to % BOARD_SIZE, EMPTY, 0, is_capture};
+        (*move_count)++;
+    }
+}
+
+// --- Evaluation Tables ---
+// Material plus a positional value for every (color, piece, square), kept summed
+// in board->psq_score by set_square(), so evaluate_board() does no per-piece work.
+// Mobility is the number of squares a piece would reach from the square on an
+// empty board, moves to the other layers included: central squares of the
+// middle layer score highest. Black's tables mirror White's through the centre
+// of the cube and are stored negated.
+
+static const int piece_values[KING + 1] = {0, 100, 320, 330, 500, 900, 20000}; // EMPTY, P, N, B, R, Q, K
+static const int mobility_weight[KING + 1] = {0, 0, 3, 2, 1, 1, 0}; // Per reachable square above the average
+
+#define PAWN_ADVANCE_BONUS    5  // Per row towards promotion
+#define PAWN_CENTER_BONUS     10 // Rows and columns 2..5 (CENTER_MASK)
+#define KING_ADVANCE_PENALTY  10 // Per row away from the home row
+#define KING_RAY_PENALTY      2  // Per direction from which sliders on other layers can reach the square
+#define KING_EXPOSURE_PENALTY 6  // Per empty square around the king on an adjacent layer, while the opponent has a queen
+
+static int psq_table[2][KING + 1][NUM_SQUARES];
+static bool eval_tables_ready = false;
+
+// Squares reachable from sq on an empty board
+static int empty_board_mobility(enum Piece piece, int sq) {
+    int layer = sq / BOARD_SQUARES, from = sq % BOARD_SQUARES;
+    int layers_in_reach = 1 + (layer > 0) + (layer < BOARD_LAYERS - 1);
+    int mobility = 0;
+    if (piece == KNIGHT) return __builtin_popcountll(knight_mask[from]) * layers_in_reach;
+    for (int d = 0; d < NUM_DIRECTIONS; d++) {
+        bool diagonal = direction_is_diagonal[d];
+        if ((piece == BISHOP && !diagonal) || (piece == ROOK && diagonal)) continue;
+        mobility += (d < FLAT_DIRECTIONS) ? __builtin_popcountll(line_mask[from][d]) : ray_length[sq][d];
+    }
+    return mobility;
+}
+
+// White's view; value of the piece standing on (layer, row, col)
+static int positional_value(enum Piece piece, int layer, int row, int col, const int average_mobility[]) {
+    int sq = square_index(layer, row, col);
+    switch (piece) {
+        case PAWN:
+            return PAWN_ADVANCE_BONUS * (6 - row) + ((CENTER_MASK >> (row * BOARD_SIZE + col)) & 1) * PAWN_CENTER_BONUS;
+        case KNIGHT:
+        case BISHOP:
+        case ROOK:
+        case QUEEN:
+            return mobility_weight[piece] * (empty_board_mobility(piece, sq) - average_mobility[piece]);
+        case KING: {
+            int open_rays = 0;
+            for (int d = FLAT_DIRECTIONS; d < NUM_DIRECTIONS; d++) open_rays += (ray_length[sq][d] > 0);
+            return -KING_ADVANCE_PENALTY * (BOARD_SIZE - 1 - row) - KING_RAY_PENALTY * open_rays;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Needs the attack tables
+static void init_eval_tables(void) {
+    if (eval_tables_ready) return;
+
+    int average_mobility[KING + 1] = {0};
+    for (int piece = KNIGHT; piece <= QUEEN; piece++) {
+        int total = 0;
+        for (int sq = 0; sq < NUM_SQUARES; sq++) total += empty_board_mobility(piece, sq);
+        average_mobility[piece] = total / NUM_SQUARES;
+    }
+
+    for (int piece = PAWN; piece <= KING; piece++) {
+        for (int layer = 0; layer < BOARD_LAYERS; layer++) {
+            for (int row = 0; row < BOARD_SIZE; row++) {
+                for (int col = 0; col < BOARD_SIZE; col++) {
+                    int value = piece_values[piece] + positional_value(piece, layer, row, col, average_mobility);
+                    psq_table[P_WHITE][piece][square_index(layer, row, col)] = value;
+                    psq_table[P_BLACK][piece][square_index(BOARD_LAYERS - 1 - layer, BOARD_SIZE - 1 - row, col)] = -value;
+                }
+            }
+        }
+    }
+    eval_tables_ready = true;
+}
+
+// --- Zobrist Hashing ---
+// Fixed-seed keys so that hashes (and searches) are reproducible between runs.
+
+static uint64_t zobrist_piece[2][KING + 1][NUM_SQUARES];
+static uint64_t zobrist_castling[4]; // White kingside, white queenside, black kingside, black queenside
+static uint64_t zobrist_en_passant[NUM_SQUARES];
+static uint64_t zobrist_black_to_move;
+static bool zobrist_ready = false;
+
+static uint64_t next_random(uint64_t *state) { // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static void init_zobrist_keys(void) {
+    if (zobrist_ready) return;
+    uint64_t seed = 0x3D3D3D3D12345678ULL;
+    for (int color = P_WHITE; color <= P_BLACK; color++) {
+        for (int piece = PAWN; piece <= KING; piece++) {
+            for (int sq = 0; sq < NUM_SQUARES; sq++) zobrist_piece[color][piece][sq] = next_random(&seed);
+        }
+    }
+    for (int i = 0; i < 4; i++) zobrist_castling[i] = next_random(&seed);
+    for (int sq = 0; sq < NUM_SQUARES; sq++) zobrist_en_passant[sq] = next_random(&seed);
+    zobrist_black_to_move = next_random(&seed);
+    zobrist_ready = true;
+}
+
+// Castling rights and en passant square: the non-piece part of the key that make_move toggles
+static uint64_t state_key(const struct Board *board) {
+    uint64_t key = 0;
+    if (board->white_castle_kingside) key ^= zobrist_castling[0];
+    if (board->white_castle_queenside) key ^= zobrist_castling[1];
+    if (board->black_castle_kingside) key ^= zobrist_castling[2];
+    if (board->black_castle_queenside) key ^= zobrist_castling[3];
+    if (board->en_passant_layer >= 0) {
+        key ^= zobrist_en_passant[square_index(board->en_passant_layer, board->en_passant_row, board->en_passant_col)];
+    }
+    return key;
+}
+
+// Full recomputation; make_move/undo_move maintain the same value incrementally
+static uint64_t compute_hash(const struct Board *board) {
+    uint64_t key = state_key(board);
+    for (int sq = 0; sq < NUM_SQUARES; sq++) {
+        const struct Square *square = square_at(board, sq);
+        if (square->piece != EMPTY) key ^= zobrist_piece[square->color][square->piece][sq];
+    }
+    if (board->current_player == P_BLACK) key ^= zobrist_black_to_move;
+    return key;
+}
+
+// --- Transposition Table ---
+// Shared by all search threads without locks. Each slot holds the packed entry
+// and key ^ data; a slot torn by two threads writing at once no longer
+// verifies against any key, so a probe simply misses.
+
+enum TTFlag { TT_EXACT, TT_LOWER, TT_UPPER }; // Bound type of the stored score
+
+// Unpacked view of a slot
+struct TTEntry {
+    uint32_t move;  // encode_move() of the best move, 0 if none
+    int32_t score;  // White positive, like minimax
+    int8_t depth;
+    uint8_t flag;
+};
+
+struct TTSlot {
+    _Atomic uint64_t check; // key ^ data
+    _Atomic uint64_t data;  // move (bits 0-19) | score (20-51) | depth (52-59) | flag (60-61)
+};
+
+static struct TTSlot *tt_slots = NULL;
+static size_t tt_mask = 0; // Slot count - 1 (power of two)
+
+// Not while a search is running: the threads hold no reference to the old table
+bool tt_resize(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(struct TTSlot) <= megabytes * 1024 * 1024) count *= 2;
+    struct TTSlot *slots = calloc(count, sizeof(struct TTSlot));
+    if (slots == NULL) return false;
+    free(tt_slots);
+    tt_slots = slots;
+    tt_mask = count - 1;
+    return true;
+}
+
+void tt_clear(void) {
+    if (tt_slots) memset(tt_slots, 0, (tt_mask + 1) * sizeof(struct TTSlot));
+}
+
+static uint64_t tt_pack(uint32_t move, int score, int depth, enum TTFlag flag) {
+    return (uint64_t)move | (uint64_t)(uint32_t)score << 20 |
+           (uint64_t)(uint8_t)depth << 52 | (uint64_t)flag << 60;
+}
+
+// Returns false on a miss; on a hit unpacks the entry so later stores cannot change it underneath
+static bool tt_probe(uint64_t key, struct TTEntry *out) {
+    struct TTSlot *slot = &tt_slots[key & tt_mask];
+    uint64_t data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+    if ((check ^ data) != key) return false;
+    out->move = (uint32_t)(data & 0xFFFFF);
+    out->score = (int32_t)(uint32_t)(data >> 20);
+    out->depth = (int8_t)(data >> 52);
+    out->flag = (uint8_t)((data >> 60) & 3);
+    return true;
+}
+
+// Depth-preferred within one position; a different position always takes the slot
+static void tt_store(uint64_t key, int depth, int score, enum TTFlag flag, uint32_t move) {
+    struct TTSlot *slot = &tt_slots[key & tt_mask];
+    uint64_t old_data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    uint64_t old_check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+    if ((old_check ^ old_data) == key && (int8_t)(old_data >> 52) > depth) return;
+    uint64_t data = tt_pack(move, score, depth, flag);
+    atomic_store_explicit(&slot->data, data, memory_order_relaxed);
+    atomic_store_explicit(&slot->check, key ^ data, memory_order_relaxed);
+}
+
+// Square indices and promotion packed into 19 bits; from != to, so 0 never encodes a move
+static uint32_t encode_move(const struct Move *move) {
+    return (uint32_t)square_index(move->from_layer, move->from_row, move->from_col) |
+           (uint32_t)square_index(move->to_layer, move->to_row, move->to_col) << 8 |
+           (uint32_t)move->promotion << 16;
+}
+
+// --- Move Ordering ---
+// Move.score ranks moves for the search: hash move, promotions, captures by
+// MVV-LVA (most valuable victim, then least valuable attacker), the two killer
+// moves of the ply, then quiet moves by history.
+
+#define MAX_SEARCH_PLY 64
+#define ORDER_HASH_MOVE 4000000
+#define ORDER_PROMOTION 3000000 // + promoted piece
+#define ORDER_CAPTURE   2000000 // + 8 * victim - attacker
+#define ORDER_KILLER    1000000 // First killer scores one more than the second
+#define HISTORY_MAX     (ORDER_KILLER - 1)
+
+static _Thread_local struct Move killer_moves[MAX_SEARCH_PLY][2]; // Quiet moves that caused a cutoff at this ply
+static _Thread_local int history_scores[2][KING + 1][NUM_SQUARES]; // [color][piece][to]: depth^2 per cutoff
+static _Thread_local int search_root_ply; // board->ply at the root of the running search
+
+static bool same_move(const struct Move *a, const struct Move *b) {
+    return a->from_layer == b->from_layer && a->from_row == b->from_row && a->from_col == b->from_col &&
+           a->to_layer == b->to_layer && a->to_row == b->to_row && a->to_col == b->to_col &&
+           a->promotion == b->promotion;
+}
+
+static void score_moves(const struct Board *board, struct Move moves[], int move_count, uint32_t hash_move, int ply) {
+    for (int i = 0; i < move_count; i++) {
+        struct Move *move = &moves[i];
+        enum Piece attacker = board->squares[move->from_layer][move->from_row][move->from_col].piece;
+        if (hash_move != 0 && encode_move(move) == hash_move) {
+            move->score = ORDER_HASH_MOVE;
+        } else if (move->promotion != EMPTY) {
+            move->score = ORDER_PROMOTION + move->promotion;
+        } else if (move->is_capture) {
+            enum Piece victim = board->squares[move->to_layer][move->to_row][move->to_col].piece;
+            if (victim == EMPTY) victim = PAWN; // En passant
+            move->score = ORDER_CAPTURE + 8 * victim - attacker;
+        } else if (ply < MAX_SEARCH_PLY && same_move(move, &killer_moves[ply][0])) {
+            move->score = ORDER_KILLER + 1;
+        } else if (ply < MAX_SEARCH_PLY && same_move(move, &killer_moves[ply][1])) {
+            move->score = ORDER_KILLER;
+        } else {
+            move->score = history_scores[board->current_player][attacker][square_index(move->to_layer, move->to_row, move->to_col)];
+        }
+    }
+}
+
+// Selection step: swaps the best-scored move of moves[index..] into moves[index].
+// Cheaper than a full sort when an early move produces a cutoff.
+static void pick_next_move(struct Move moves[], int move_count, int index) {
+    int best = index;
+    for (int i = index + 1; i < move_count; i++) {
+        if (moves[i].score > moves[best].score) best = i;
+    }
+    if (best != index) {
+        struct Move tmp = moves[index];
+        moves[index] = moves[best];
+        moves[best] = tmp;
+    }
+}
+
+// Called with the board back in the position where `move` caused a beta cutoff
+static void record_cutoff(const struct Board *board, const struct Move *move, int depth, int ply) {
+    if (move->is_capture || move->promotion != EMPTY) return; // Those are already ordered first
+    if (ply < MAX_SEARCH_PLY && !same_move(move, &killer_moves[ply][0])) {
+        killer_moves[ply][1] = killer_moves[ply][0];
+        killer_moves[ply][0] = *move;
+    }
+    enum Piece piece = board->squares[move->from_layer][move->from_row][move->from_col].piece;
+    int *history = &history_scores[board->current_player][piece][square_index(move->to_layer, move->to_row, move->to_col)];
+    *history += depth * depth;
+    if (*history > HISTORY_MAX) {
+        // Halve everything so relative order survives and nothing reaches the killer band
+        for (int c = 0; c < 2; c++)
+            for (int p = 0; p <= KING; p++)
+                for (int sq = 0; sq < NUM_SQUARES; sq++) history_scores[c][p][sq] /= 2;
+    }
+}
+
+// Per-search reset: killers are position specific, history is kept but aged
+static void reset_move_ordering(const struct Board *board) {
+    memset(killer_moves, 0, sizeof(killer_moves));
+    for (int c = 0; c < 2; c++)
+        for (int p = 0; p <= KING; p++)
+            for (int sq = 0; sq < NUM_SQUARES; sq++) history_scores[c][p][sq] /= 2;
+    search_root_ply = board->ply;
+}
+
+// --- Search Control ---
+
+struct SearchState {
+    long long nodes; // Positions visited by this thread in the running ai_search
+    struct timespec deadline;
+    bool has_deadline; // Only the main search thread watches the clock
+    bool aborted;
+    atomic_bool *stop; // Shared by all threads of one ai_search; NULL outside ai_search
+};
+static _Thread_local struct SearchState search_state;
+
+#define ABORT_CHECK_INTERVAL 1024 // Nodes between clock and stop-flag checks
+
+static struct timespec time_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts;
+}
+
+// Counts a node and reports whether the current search has run out of time
+static bool search_should_abort(void) {
+    if (search_state.aborted) return true;
+    search_state.nodes++;
+    if ((search_state.nodes % ABORT_CHECK_INTERVAL) != 0) return false;
+    if (search_state.stop && atomic_load_explicit(search_state.stop, memory_order_relaxed)) {
+        search_state.aborted = true;
+    } else if (search_state.has_deadline) {
+        struct timespec now = time_now();
+        if (now.tv_sec > search_state.deadline.tv_sec ||
+            (now.tv_sec == search_state.deadline.tv_sec && now.tv_nsec >= search_state.deadline.tv_nsec)) {
+            search_state.aborted = true;
+            if (search_state.stop) atomic_store_explicit(search_state.stop, true, memory_order_relaxed);
+        }
+    }
+    return search_state.aborted;
+}
+
+// --- Board ---
+
+static const struct Square empty_square = {EMPTY, P_NONE};
+
+// Every piece placement goes through here: keeps the bitboards in step with the mailbox
+static void set_square(struct Board *board, int layer, int row, int col, struct Square value) {
+    struct Square *sq = &board->squares[layer][row][col];
+    uint64_t bit = SQUARE_BIT(row, col);
+    int index = square_index(layer, row, col);
+    if (sq->piece != EMPTY) {
+        board->piece_bb[sq->color][sq->piece][layer] &= ~bit;
+        board->color_bb[sq->color][layer] &= ~bit;
+        board->hash ^= zobrist_piece[sq->color][sq->piece][index];
+        board->psq_score -= psq_table[sq->color][sq->piece][index];
+        if (sq->piece == KING && board->king_square[sq->color] == index) board->king_square[sq->color] = -1;
+    }
+    *sq = value;
+    if (value.piece != EMPTY) {
+        board->piece_bb[value.color][value.piece][layer] |= bit;
+        board->color_bb[value.color][layer] |= bit;
+        board->hash ^= zobrist_piece[value.color][value.piece][index];
+        board->psq_score += psq_table[value.color][value.piece][index];
+        if (value.piece == KING) board->king_square[value.color] = index;
+    }
+}
+
+void init_board(struct Board *board) {
+    init_attack_tables();
+    init_eval_tables();
+    init_zobrist_keys();
+    if (tt_slots == NULL) tt_resize(TT_DEFAULT_MB);
+    memset(board->piece_bb, 0, sizeof(board->piece_bb));
+    memset(board->color_bb, 0, sizeof(board->color_bb));
+    board->psq_score = 0;
+    board->king_square[P_WHITE] = board->king_square[P_BLACK] = -1;
+
+    // Initialize all squares to empty
+    for (int layer = 0; layer < BOARD_LAYERS; layer++) {
+        for (int row = 0; row < BOARD_SIZE; row++) {
+            for (int col = 0; col < BOARD_SIZE; col++) {
+                board->squares[layer][row][col].piece = EMPTY;
+                board->squares[layer][row][col].color = P_NONE;
+            }
+        }
+    }
+
+    // Layer 0 (Bottom layer) - Black Pieces
+    enum Piece back_row[BOARD_SIZE] = {ROOK, KNIGHT, BISHOP, QUEEN, KING, BISHOP, KNIGHT, ROOK};
+    // Black Back Row (row 0)
+    for (int col = 0; col < BOARD_SIZE; col++) {
+        set_square(board, 0, 0, col, (struct Square){back_row[col], P_BLACK});
+    }
+    // Black Pawns (row 1)
+    for (int col = 0; col < BOARD_SIZE; col++) {
+        set_square(board, 0, 1, col, (struct Square){PAWN, P_BLACK});
+    }
+
+    // Layer 1 (Middle layer) - Empty
+    // (Already initialized to empty above)
+
+    // Layer 2 (Top layer) - White Pieces
+    // White Pawns (row 6)
+    for (int col = 0; col < BOARD_SIZE; col++) {
+        set_square(board, 2, 6, col, (struct Square){PAWN, P_WHITE});
+    }
+    // White Back Row (row 7)
+    for (int col = 0; col < BOARD_SIZE; col++) {
+        set_square(board, 2, 7, col, (struct Square){back_row[col], P_WHITE});
+    }
+
+    // Game state
+    board->current_player = P_WHITE; // White starts
+    // Castling rights only apply to layer 0 in standard chess, adapt if needed for 3D rules
+    // For now, assume standard castling applies only if pieces are on layer 0
+    // Since kings/rooks start on different layers, disable castling initially.
+    // If your 3D rules allow inter-layer castling or different start, adjust this.
+    board->white_castle_kingside = false; // White king doesn't start on layer 0
+    board->white_castle_queenside = false;
+    board->black_castle_kingside = true; // Black king starts on layer 0
+    board->black_castle_queenside = true;
+    board->en_passant_layer = -1;
+    board->en_passant_row = -1;
+    board->en_passant_col = -1;
+    board->halfmove_clock = 0;
+    board->fullmove_number = 1;
+    board->ply = 0;
+    board->hash = compute_hash(board);
+}
+
+bool is_valid_position(int layer, int row, int col) {
+    return layer >= 0 && layer < BOARD_LAYERS &&
+           row >= 0 && row < BOARD_SIZE &&
+           col >= 0 && col < BOARD_SIZE;
+}
+
+// --- Move Generation ---
+
+static void generate_pawn_moves(const struct Board *board, int layer, int row, int col, struct Move moves[], int *move_count) {
+    enum PieceColor color = board->squares[layer][row][col].color;
+    enum PieceColor opponent_color = (color == P_WHITE) ? P_BLACK : P_WHITE;
+    int direction = (color == P_WHITE) ? -1 : 1;
+    int start_row = (color == P_WHITE) ? 6 : 1;
+    int promotion_row = (color == P_WHITE) ? 0 : 7;
+    enum Piece promo_pieces[] = {QUEEN, ROOK, BISHOP, KNIGHT};
+
+    int next_row = row + direction;
+    if (next_row < 0 || next_row >= BOARD_SIZE) return; // Reached the last row through an inter-layer move
+    uint64_t push = SQUARE_BIT(next_row, col);
+    uint64_t attacks = pawn_attack_mask[color][row * BOARD_SIZE + col];
+
+    // --- Same Layer Moves ---
+    uint64_t empty = ~layer_occupancy(board, layer);
+    uint64_t targets = (push & empty) | (attacks & board->color_bb[opponent_color][layer]);
+    while (targets) {
+        int to = pop_lsb(&targets);
+        int to_col = to % BOARD_SIZE;
+        bool is_capture = (to_col != col);
+        if (next_row == promotion_row) {
+            for (int i = 0; i < 4; i++) {
+                moves[*move_count] = (struct Move){layer, row, col, layer, next_row, to_col, promo_pieces[i], 0, is_capture};
+                (*move_count)++;
+            }
+        } else {
+            moves[*move_count] = (struct Move){layer, row, col, layer, next_row, to_col, EMPTY, 0, is_capture};
+            (*move_count)++;
+        }
+    }
+
+    // Double move from starting position
+    if (row == start_row && (push & empty) && (SQUARE_BIT(row + 2*direction, col) & empty)) {
+        moves[*move_count] = (struct Move){layer, row, col, layer, row + 2*direction, col, EMPTY, 0, false};
+        (*move_count)++;
+    }
+
+    // En passant capture
+    if (layer == board->en_passant_layer &&
+        (attacks & SQUARE_BIT(board->en_passant_row, board->en_passant_col)) &&
+        color != board->squares[layer][board->en_passant_row - direction][board->en_passant_col].color) { // Check color of pawn that moved
+        moves[*move_count] = (struct Move){layer, row, col, layer, next_row, board->en_passant_col, EMPTY, 0, true};
+        (*move_count)++;
+    }
+
+    // --- Inter-Layer Moves ---
+    // No promotion on inter-layer moves for simplicity, could be added
+    for (int layer_change = -1; layer_change <= 1; layer_change += 2) {
+        int new_layer = layer + layer_change;
+        if (new_layer < 0 || new_layer >= BOARD_LAYERS) continue;
+        add_target_moves(board, layer, row, col, new_layer, push & ~layer_occupancy(board, new_layer), moves, move_count);
+        add_target_moves(board, layer, row, col, new_layer, attacks & board->color_bb[opponent_color][new_layer], moves, move_count);
+    }
+}
+
+
+static void generate_knight_moves(const struct Board *board, int layer, int row, int col, struct Move moves[], int *move_count) {
+    uint64_t targets = knight_mask[row * BOARD_SIZE + col];
+    enum PieceColor color = board->squares[layer][row][col].color;
+
+    // Same pattern on the current and adjacent layers
+    for (int l_offset = -1; l_offset <= 1; ++l_offset) {
+        int current_layer = layer + l_offset;
+        if (current_layer < 0 || current_layer >= BOARD_LAYERS) continue;
+        add_target_moves(board, layer, row, col, current_layer, targets & ~board->color_bb[color][current_layer], moves, move_count);
+    }
+}
+
+
+// Bishop (diagonal) or rook (straight) slides: bitboard rays within the layer,
+// precomputed ray lists for the directions that change layer
+static void generate_slider_moves(const struct Board *board, int layer, int row, int col, bool diagonal, struct Move moves[], int *move_count) {
+    enum PieceColor color = board->squares[layer][row][col].color;
+    int from = row * BOARD_SIZE + col;
+    uint64_t occupied = layer_occupancy(board, layer);
+    uint64_t attacks = diagonal ? bishop_attacks(from, occupied) : rook_attacks(from, occupied);
+    add_target_moves(board, layer, row, col, layer, attacks & ~board->color_bb[color][layer], moves, move_count);
+
+    int sq = square_index(layer, row, col);
+    for (int d = FLAT_DIRECTIONS; d < NUM_DIRECTIONS; d++) {
+        if (direction_is_diagonal[d] != diagonal) continue;
+        for (int step = 0; step < ray_length[sq][d]; step++) {
+            int to = ray_squares[sq][d][step];
+            const struct Square *target_sq = square_at(board, to);
+            if (target_sq->piece == EMPTY || target_sq->color != color) {
+                moves[*move_count] = (struct Move){layer, row, col, to / BOARD_SQUARES, (to / BOARD_SIZE) % BOARD_SIZE, to % BOARD_SIZE,
+                                                   EMPTY, 0, target_sq->piece != EMPTY};
+                (*move_count)++;
+            }
+            if (target_sq->piece != EMPTY) break; // Stop sliding after encountering any piece
+        }
+    }
+}
+
+static void generate_bishop_moves(const struct Board *board, int layer, int row, int col, struct Move moves[], int *move_count) {
+    generate_slider_moves(board, layer, row, col, true, moves, move_count);
+}
+
+static void generate_rook_moves(const struct Board *board, int layer, int row, int col, struct Move moves[], int *move_count) {
+    generate_slider_moves(board, layer, row, col, false, moves, move_count);
+}
+
+static void generate_queen_moves(const struct Board *board, int layer, int row, int col, struct Move moves[], int *move_count) {
+    generate_bishop_moves(board, layer, row, col, moves, move_count);
+    generate_rook_moves(board, layer, row, col, moves, move_count);
+}
+
+static void generate_king_moves(const struct Board *board, int layer, int row, int col, struct Move moves[], int *move_count) {
+    enum PieceColor player_color = board->squares[layer][row][col].color;
+    enum PieceColor opponent_color = (player_color == P_WHITE) ? P_BLACK : P_WHITE;
+
+    // All adjacent squares in 3D: the flat neighbours plus the square straight above/below
+    for (int l_offset = -1; l_offset <= 1; ++l_offset) {
+        int new_layer = layer + l_offset;
+        if (new_layer < 0 || new_layer >= BOARD_LAYERS) continue;
+        uint64_t targets = king_mask[row * BOARD_SIZE + col];
+        if (l_offset != 0) targets |= SQUARE_BIT(row, col);
+        // Legality check regarding check will be done later in generate_legal_moves
+        add_target_moves(board, layer, row, col, new_layer, targets & ~board->color_bb[player_color][new_layer], moves, move_count);
+    }
+
+    // --- Castling --- 
+    // Standard chess castling rules applied only to layer 0 for this implementation.
+    // Modify if your 3D rules allow inter-layer castling.
+    if (layer == 0) { 
+        int king_row = (player_color == P_WHITE) ? 7 : 0;
+        int king_col_start = 4; // Standard king starting column (E file)
+
+        // Check if king is in the correct starting position (row check is sufficient if castling rights are checked)
+        if (row == king_row && col == king_col_start) {
+            // Check if king is currently in check
+            if (!is_king_in_check(board, player_color)) { 
+                // Kingside Castling (O-O)
+                bool can_castle_kingside = (player_color == P_WHITE) ? board->white_castle_kingside : board->black_castle_kingside;
+                if (can_castle_kingside &&
+                    board->squares[layer][king_row][king_col_start + 1].piece == EMPTY && // F1/F8 empty
+                    board->squares[layer][king_row][king_col_start + 2].piece == EMPTY && // G1/G8 empty
+                    !is_square_attacked(board, layer, king_row, king_col_start + 1, opponent_color) && // F1/F8 not attacked
+                    !is_square_attacked(board, layer, king_row, king_col_start + 2, opponent_color))   // G1/G8 not attacked (king lands here)
+                {
+                    // Add kingside castling move (king moves 2 squares)
+                    moves[*move_count] = (struct Move){layer, row, col, layer, king_row, king_col_start + 2, EMPTY, 0, false};
+                    (*move_count)++;
+                }
+
+                // Queenside Castling (O-O-O)
+                bool can_castle_queenside = (player_color == P_WHITE) ? board->white_castle_queenside : board->black_castle_queenside;
+                if (can_castle_queenside &&
+                    board->squares[layer][king_row][king_col_start - 1].piece == EMPTY && // D1/D8 empty
+                    board->squares[layer][king_row][king_col_start - 2].piece == EMPTY && // C1/C8 empty
+                    board->squares[layer][king_row][king_col_start - 3].piece == EMPTY && // B1/B8 empty
+                    !is_square_attacked(board, layer, king_row, king_col_start - 1, opponent_color) && // D1/D8 not attacked
+                    !is_square_attacked(board, layer, king_row, king_col_start - 2, opponent_color))   // C1/C8 not attacked (king lands here)
+                    // B1/B8 doesn't need to be checked for attack as king doesn't pass through it
+                {
+                    // Add queenside castling move (king moves 2 squares)
+                    moves[*move_count] = (struct Move){layer, row, col, layer, king_row, king_col_start - 2, EMPTY, 0, false};
+                    (*move_count)++;
+                }
+            }
+        }
+    }
+}
+
+void generate_moves_for_piece(const struct Board *board, int layer, int row, int col, struct Move moves[], int *move_count) {
+    switch (board->squares[layer][row][col].piece) {
+        case PAWN:   generate_pawn_moves(board, layer, row, col, moves, move_count);   break;
+        case KNIGHT: generate_knight_moves(board, layer, row, col, moves, move_count); break;
+        case BISHOP: generate_bishop_moves(board, layer, row, col, moves, move_count); break;
+        case ROOK:   generate_rook_moves(board, layer, row, col, moves, move_count);   break;
+        case QUEEN:  generate_queen_moves(board, layer, row, col, moves, move_count);  break;
+        case KING:   generate_king_moves(board, layer, row, col, moves, move_count);   break;
+        case EMPTY:  break;
+    }
+}
+
+// Generates all pseudo-legal moves for the current player
+// Renamed from generate_all_moves to avoid confusion
+int generate_pseudo_legal_moves(const struct Board *board, struct Move moves[]) {
+    int move_count = 0;
+    enum PieceColor current_player = board->current_player;
+
+    for (int layer = 0; layer < BOARD_LAYERS; layer++) {
+        uint64_t pieces = board->color_bb[current_player][layer];
+        while (pieces) {
+            int sq = pop_lsb(&pieces);
+            generate_moves_for_piece(board, layer, sq / BOARD_SIZE, sq % BOARD_SIZE, moves, &move_count);
+        }
+    }
+    return move_count;
+}
+
+// Captures and promotions of the side to move, pseudo-legal, for the quiescence
+// search. Quiet moves are never generated, so the many quiet moves to the other
+// layers cost nothing. Promotions are to a queen only.
+static int generate_captures(const struct Board *board, struct Move moves[]) {
+    int move_count = 0;
+    enum PieceColor color = board->current_player;
+    enum PieceColor opponent_color = (color == P_WHITE) ? P_BLACK : P_WHITE;
+
+    for (int layer = 0; layer < BOARD_LAYERS; layer++) {
+        uint64_t pieces = board->color_bb[color][layer];
+        while (pieces) {
+            int from = pop_lsb(&pieces);
+            int row = from / BOARD_SIZE, col = from % BOARD_SIZE;
+            int lowest = (layer > 0) ? layer - 1 : layer;
+            int highest = (layer < BOARD_LAYERS - 1) ? layer + 1 : layer;
+            switch (board->squares[layer][row][col].piece) {
+                case PAWN: {
+                    int direction = (color == P_WHITE) ? -1 : 1;
+                    int next_row = row + direction;
+                    if (next_row < 0 || next_row >= BOARD_SIZE) break;
+                    uint64_t attacks = pawn_attack_mask[color][from];
+                    uint64_t targets = attacks & board->color_bb[opponent_color][layer];
+                    bool promotes = (next_row == ((color == P_WHITE) ? 0 : 7));
+                    if (promotes) targets |= SQUARE_BIT(next_row, col) & ~layer_occupancy(board, layer);
+                    while (targets) {
+                        int to = pop_lsb(&targets);
+                        moves[move_count++] = (struct Move){layer, row, col, layer, next_row, to % BOARD_SIZE,
+                                                            promotes ? QUEEN : EMPTY, 0, (to % BOARD_SIZE) != col};
+                    }
+                    if (layer == board->en_passant_layer &&
+                        (attacks & SQUARE_BIT(board->en_passant_row, board->en_passant_col)) &&
+                        color != board->squares[layer][board->en_passant_row - direction][board->en_passant_col].color) {
+                        moves[move_count++] = (struct Move){layer, row, col, layer, next_row, board->en_passant_col, EMPTY, 0, true};
+                    }
+                    for (int l = lowest; l <= highest; l++) {
+                        if (l != layer) add_target_moves(board, layer, row, col, l, attacks & board->color_bb[opponent_color][l], moves, &move_count);
+                    }
+                    break;
+                }
+                case KNIGHT:
+                    for (int l = lowest; l <= highest; l++) {
+                        add_target_moves(board, layer, row, col, l, knight_mask[from] & board->color_bb[opponent_color][l], moves, &move_count);
+                    }
+                    break;
+                case KING:
+                    for (int l = lowest; l <= highest; l++) {
+                        uint64_t targets = king_mask[from] | ((l != layer) ? SQUARE_BIT(row, col) : 0);
+                        add_target_moves(board, layer, row, col, l, targets & board->color_bb[opponent_color][l], moves, &move_count);
+                    }
+                    break;
+                case BISHOP:
+                case ROOK:
+                case QUEEN: {
+                    enum Piece piece = board->squares[layer][row][col].piece;
+                    uint64_t occupied = layer_occupancy(board, layer);
+                    uint64_t attacks = 0;
+                    if (piece != ROOK) attacks |= bishop_attacks(from, occupied);
+                    if (piece != BISHOP) attacks |= rook_attacks(from, occupied);
+                    add_target_moves(board, layer, row, col, layer, attacks & board->color_bb[opponent_color][layer], moves, &move_count);
+
+                    int sq = square_index(layer, row, col);
+                    for (int d = FLAT_DIRECTIONS; d < NUM_DIRECTIONS; d++) {
+                        if ((piece == BISHOP && !direction_is_diagonal[d]) || (piece == ROOK && direction_is_diagonal[d])) continue;
+                        for (int step = 0; step < ray_length[sq][d]; step++) {
+                            int to = ray_squares[sq][d][step];
+                            const struct Square *target_sq = square_at(board, to);
+                            if (target_sq->piece == EMPTY) continue;
+                            if (target_sq->color == opponent_color) {
+                                moves[move_count++] = (struct Move){layer, row, col, to / BOARD_SQUARES, (to / BOARD_SIZE) % BOARD_SIZE,
+                                                                    to % BOARD_SIZE, EMPTY, 0, true};
+                            }
+                            break; // First piece on the ray ends it
+                        }
+                    }
+                    break;
+                }
+                case EMPTY:
+                    break;
+            }
+        }
+    }
+    return move_count;
+}
+
+// Where the side to move may go without exposing its king, one bitboard per
+// layer. Built once per node from the king's 26 rays plus knight and pawn checks.
+struct LegalityMasks {
+    uint64_t check_mask[BOARD_LAYERS]; // Captures or blocks every check; all squares when not in check
+    uint64_t pinned[BOARD_LAYERS];     // Own pieces between the king and an enemy slider
+    int pin_count;
+    int pin_square[NUM_DIRECTIONS];                  // At most one pinned piece per ray
+    uint64_t pin_ray[NUM_DIRECTIONS][BOARD_LAYERS];  // King to pinner, pinner included
+};
+
+static bool mask_has(const uint64_t mask[], int layer, int row, int col) {
+    return (mask[layer] >> (row * BOARD_SIZE + col)) & 1;
+}
+
+static void compute_legality_masks(const struct Board *board, enum PieceColor color, struct LegalityMasks *masks) {
+    enum PieceColor opponent_color = (color == P_WHITE) ? P_BLACK : P_WHITE;
+    int king = board->king_square[color];
+    int checker_count = 0;
+    masks->pin_count = 0;
+    for (int l = 0; l < BOARD_LAYERS; l++) masks->check_mask[l] = masks->pinned[l] = 0;
+    if (king < 0) { // No king, nothing to expose
+        for (int l = 0; l < BOARD_LAYERS; l++) masks->check_mask[l] = ~0ULL;
+        return;
+    }
+
+    // Knights and pawns can only be captured; the same masks apply on the adjacent layers
+    int king_layer = king / BOARD_SQUARES, king_from = king % BOARD_SQUARES;
+    for (int l = king_layer - 1; l <= king_layer + 1; l++) {
+        if (l < 0 || l >= BOARD_LAYERS) continue;
+        uint64_t checkers = (knight_mask[king_from] & board->piece_bb[opponent_color][KNIGHT][l]) |
+                            (pawn_attack_mask[color][king_from] & board->piece_bb[opponent_color][PAWN][l]);
+        masks->check_mask[l] |= checkers;
+        checker_count += __builtin_popcountll(checkers);
+    }
+
+    // Sliders: the first enemy piece on a ray checks, the second pins the own piece in front of it
+    for (int d = 0; d < NUM_DIRECTIONS; d++) {
+        enum Piece slider = direction_is_diagonal[d] ? BISHOP : ROOK;
+        uint64_t ray[BOARD_LAYERS] = {0};
+        int own_square = -1;
+        for (int step = 0; step < ray_length[king][d]; step++) {
+            int sq = ray_squares[king][d][step];
+            ray[sq / BOARD_SQUARES] |= 1ULL << (sq % BOARD_SQUARES);
+            const struct Square *target_sq = square_at(board, sq);
+            if (target_sq->piece == EMPTY) continue;
+            if (target_sq->color == color) {
+                if (own_square >= 0) break; // Two own pieces: no pin
+                own_square = sq;
+                continue;
+            }
+            if (target_sq->piece == QUEEN || target_sq->piece == slider) {
+                if (own_square < 0) {
+                    checker_count++;
+                    for (int l = 0; l < BOARD_LAYERS; l++) masks->check_mask[l] |= ray[l];
+                } else {
+                    masks->pinned[own_square / BOARD_SQUARES] |= 1ULL << (own_square % BOARD_SQUARES);
+                    masks->pin_square[masks->pin_count] = own_square;
+                    for (int l = 0; l < BOARD_LAYERS; l++) masks->pin_ray[masks->pin_count][l] = ray[l];
+                    masks->pin_count++;
+                }
+            }
+            break;
+        }
+    }
+
+    if (checker_count == 0) {
+        for (int l = 0; l < BOARD_LAYERS; l++) masks->check_mask[l] = ~0ULL;
+    } else if (checker_count > 1) { // Double check: only the king may move
+        for (int l = 0; l < BOARD_LAYERS; l++) masks->check_mask[l] = 0;
+    }
+}
+
+// Generates only legal moves for the current player. Checks and pins are
+// computed once, so most moves are accepted by two mask lookups; only king
+// moves and en passant (which can uncover a check) are played out and tested.
+int generate_legal_moves(struct Board *board, struct Move moves[]) {
+    struct Move pseudo_legal_moves[MAX_MOVES];
+    int pseudo_legal_count = generate_pseudo_legal_moves(board, pseudo_legal_moves);
+    int legal_move_count = 0;
+    enum PieceColor current_player = board->current_player;
+    struct LegalityMasks masks;
+    compute_legality_masks(board, current_player, &masks);
+
+    for (int i = 0; i < pseudo_legal_count; i++) {
+        const struct Move *move = &pseudo_legal_moves[i];
+        const struct Square *piece = &board->squares[move->from_layer][move->from_row][move->from_col];
+        bool en_passant = piece->piece == PAWN && move->is_capture &&
+                          board->squares[move->to_layer][move->to_row][move->to_col].piece == EMPTY;
+
+        if (piece->piece != KING && !en_passant) {
+            if (!mask_has(masks.check_mask, move->to_layer, move->to_row, move->to_col)) continue;
+            if (mask_has(masks.pinned, move->from_layer, move->from_row, move->from_col)) {
+                int from = square_index(move->from_layer, move->from_row, move->from_col);
+                int pin = 0;
+                while (masks.pin_square[pin] != from) pin++;
+                if (!mask_has(masks.pin_ray[pin], move->to_layer, move->to_row, move->to_col)) continue;
+            }
+            moves[legal_move_count++] = *move;
+            continue;
+        }
+
+        make_move(board, move);
+        if (!is_king_in_check(board, current_player)) {
+            moves[legal_move_count++] = *move;
+        }
+        undo_move(board, move);
+    }
+
+    return legal_move_count;
+}
+
+// Leaf nodes `depth` plies below the board. The last ply is counted from the
+// legal move list instead of being played out.
+long long perft(struct Board *board, int depth) {
+    if (depth <= 0) return 1;
+    struct Move moves[MAX_MOVES];
+    int move_count = generate_legal_moves(board, moves);
+    if (depth == 1) return move_count;
+
+    long long nodes = 0;
+    for (int i = 0; i < move_count; i++) {
+        make_move(board, &moves[i]);
+        nodes += perft(board, depth - 1);
+        undo_move(board, &moves[i]);
+    }
+    return nodes;
+}
+
+
+void make_move(struct Board *board, const struct Move *move) {
+    struct Square moved_piece = board->squares[move->from_layer][move->from_row][move->from_col];
+    struct Square target_square = board->squares[move->to_layer][move->to_row][move->to_col]; // Store target for capture info
+
+    // --- Store current state for undo ---
+    struct PreviousState *prev_state = &board->undo_stack[board->ply % UNDO_STACK_SIZE];
+    prev_state->captured = target_square;
+    prev_state->captured_layer = move->to_layer;
+    prev_state->captured_row = move->to_row;
+    prev_state->captured_col = move->to_col;
+    prev_state->white_castle_kingside = board->white_castle_kingside;
+    prev_state->white_castle_queenside = board->white_castle_queenside;
+    prev_state->black_castle_kingside = board->black_castle_kingside;
+    prev_state->black_castle_queenside = board->black_castle_queenside;
+    prev_state->en_passant_layer = board->en_passant_layer;
+    prev_state->en_passant_row = board->en_passant_row;
+    prev_state->en_passant_col = board->en_passant_col;
+    prev_state->halfmove_clock = board->halfmove_clock;
+    prev_state->hash = board->hash;
+    board->ply++;
+    board->hash ^= state_key(board); // Take out the old rights and en passant square
+
+    // --- Handle Special Moves ---
+    bool is_en_passant_capture = false;
+
+    // En Passant Capture
+    if (moved_piece.piece == PAWN &&
+        move->to_col != move->from_col &&
+        target_square.piece == EMPTY &&
+        move->to_layer == board->en_passant_layer && // Must move to the en passant layer
+        move->to_row == board->en_passant_row &&
+        move->to_col == board->en_passant_col)
+    {
+        is_en_passant_capture = true;
+        // Clear the captured pawn's square (which is behind the target square)
+        prev_state->captured = board->squares[move->from_layer][move->from_row][move->to_col];
+        prev_state->captured_layer = move->from_layer;
+        prev_state->captured_row = move->from_row;
+        prev_state->captured_col = move->to_col;
+        set_square(board, move->from_layer, move->from_row, move->to_col, empty_square);
+    }
+
+    // Castling (only on layer 0)
+    if (moved_piece.piece == KING && abs(move->to_col - move->from_col) == 2 && move->from_layer == 0 && move->to_layer == 0) {
+        // Move the rook
+        if (move->to_col == 6) { // Kingside
+            set_square(board, 0, move->from_row, 5, board->squares[0][move->from_row][7]);
+            set_square(board, 0, move->from_row, 7, empty_square);
+        } else { // Queenside (move->to_col == 2)
+            set_square(board, 0, move->from_row, 3, board->squares[0][move->from_row][0]);
+            set_square(board, 0, move->from_row, 0, empty_square);
+        }
+    }
+
+    // --- Update Board ---
+    if (move->promotion != EMPTY) {
+        set_square(board, move->to_layer, move->to_row, move->to_col, (struct Square){move->promotion, moved_piece.color});
+    } else {
+        set_square(board, move->to_layer, move->to_row, move->to_col, moved_piece);
+    }
+    // Clear the original square
+    set_square(board, move->from_layer, move->from_row, move->from_col, empty_square);
+
+
+    // --- Update Game State ---
+    // Reset en passant target square by default
+    board->en_passant_layer = -1;
+    board->en_passant_row = -1;
+    board->en_passant_col = -1;
+
+    // Set new en passant target if pawn moved two squares
+    if (moved_piece.piece == PAWN && abs(move->to_row - move->from_row) == 2 && move->from_layer == move->to_layer) {
+        board->en_passant_layer = move->from_layer;
+        board->en_passant_row = (move->from_row + move->to_row) / 2;
+        board->en_passant_col = move->from_col;
+    }
+
+    // Update castling rights (only layer 0 relevant)
+    if (move->from_layer == 0) {
+        if (moved_piece.piece == KING) {
+            if (moved_piece.color == P_WHITE) {
+                board->white_castle_kingside = false;
+                board->white_castle_queenside = false;
+            } else {
+                board->black_castle_kingside = false;
+                board->black_castle_queenside = false;
+            }
+        } else if (moved_piece.piece == ROOK) {
+            if (moved_piece.color == P_WHITE) {
+                if (move->from_row == 7 && move->from_col == 0) board->white_castle_queenside = false;
+                if (move->from_row == 7 && move->from_col == 7) board->white_castle_kingside = false;
+            } else { // Black rook
+                if (move->from_row == 0 && move->from_col == 0) board->black_castle_queenside = false;
+                if (move->from_row == 0 && move->from_col == 7) board->black_castle_kingside = false;
+            }
+        }
+    }
+     // Also update if a rook is captured on its starting square (layer 0)
+    if (move->to_layer == 0) {
+         if (move->to_row == 7 && move->to_col == 0) board->white_castle_queenside = false;
+         if (move->to_row == 7 && move->to_col == 7) board->white_castle_kingside = false;
+         if (move->to_row == 0 && move->to_col == 0) board->black_castle_queenside = false;
+         if (move->to_row == 0 && move->to_col == 7) board->black_castle_kingside = false;
+    }
+
+
+    // Update halfmove clock (reset on capture or pawn move, otherwise increment)
+    if (moved_piece.piece == PAWN || target_square.piece != EMPTY || is_en_passant_capture) {
+        board->halfmove_clock = 0;
+    } else {
+        board->halfmove_clock++;
+    }
+
+    // Update fullmove number (increment after Black moves)
+    if (board->current_player == P_BLACK) {
+        board->fullmove_number++;
+    }
+
+    // Switch player
+    board->current_player = (board->current_player == P_WHITE) ? P_BLACK : P_WHITE;
+    board->hash ^= state_key(board) ^ zobrist_black_to_move;
+}
+
+// Reverts the most recent make_move using the state it pushed on the undo stack
+void undo_move(struct Board *board, const struct Move *move) {
+    board->ply--;
+    const struct PreviousState *prev_state = &board->undo_stack[board->ply % UNDO_STACK_SIZE];
+
+    // Restore Player
+    board->current_player = (board->current_player == P_WHITE) ? P_BLACK : P_WHITE;
+    if (board->current_player == P_BLACK) {
+        board->fullmove_number--;
+    }
+
+    // --- Undo Piece Movement ---
+    struct Square moved_piece = board->squares[move->to_layer][move->to_row][move->to_col];
+    if (move->promotion != EMPTY) {
+        moved_piece.piece = PAWN;
+    }
+    set_square(board, move->from_layer, move->from_row, move->from_col, moved_piece);
+    set_square(board, move->to_layer, move->to_row, move->to_col, empty_square);
+
+    // Restore captured piece (if any), including an en passant victim beside the target square
+    set_square(board, prev_state->captured_layer, prev_state->captured_row, prev_state->captured_col, prev_state->captured);
+
+    // Undo Castling Rook Move
+    if (moved_piece.piece == KING && abs(move->to_col - move->from_col) == 2 && move->from_layer == 0 && move->to_layer == 0) {
+        int rook_from_col = (move->to_col == 6) ? 7 : 0;
+        int rook_to_col = (move->to_col == 6) ? 5 : 3;
+        set_square(board, 0, move->from_row, rook_from_col, board->squares[0][move->from_row][rook_to_col]);
+        set_square(board, 0, move->from_row, rook_to_col, empty_square);
+    }
+
+    // --- Restore Board State from PreviousState ---
+    board->white_castle_kingside = prev_state->white_castle_kingside;
+    board->white_castle_queenside = prev_state->white_castle_queenside;
+    board->black_castle_kingside = prev_state->black_castle_kingside;
+    board->black_castle_queenside = prev_state->black_castle_queenside;
+    board->en_passant_layer = prev_state->en_passant_layer;
+    board->en_passant_row = prev_state->en_passant_row;
+    board->en_passant_col = prev_state->en_passant_col;
+    board->halfmove_clock = prev_state->halfmove_clock;
+    board->hash = prev_state->hash;
+}
+
+// --- Evaluation and Search ---
+
+// Heavy pieces on a neighbouring layer reach the king through any empty square
+// around it there. Constant time: at most two layers, one mask each.
+static int king_exposure(const struct Board *board, enum PieceColor king_color) {
+    enum PieceColor opponent = (king_color == P_WHITE) ? P_BLACK : P_WHITE;
+    if ((board->piece_bb[opponent][QUEEN][0] | board->piece_bb[opponent][QUEEN][1] | board->piece_bb[opponent][QUEEN][2]) == 0) return 0;
+    int layer, row, col;
+    if (!find_king(board, king_color, &layer, &row, &col)) return 0;
+    uint64_t zone = king_mask[row * BOARD_SIZE + col] | SQUARE_BIT(row, col);
+    int open_squares = 0;
+    if (layer > 0) open_squares += __builtin_popcountll(zone & ~layer_occupancy(board, layer - 1));
+    if (layer < BOARD_LAYERS - 1) open_squares += __builtin_popcountll(zone & ~layer_occupancy(board, layer + 1));
+    return KING_EXPOSURE_PENALTY * open_squares;
+}
+
+// White positive, Black negative. Material and piece-square values are already
+// summed in board->psq_score; only king exposure depends on the position as a whole.
+int evaluate_board(const struct Board *board) {
+    return board->psq_score - king_exposure(board, P_WHITE) + king_exposure(board, P_BLACK);
+}
+
+bool is_game_over(struct Board *board) { // Needs non-const board to generate legal moves
+    struct Move legal_moves[MAX_MOVES];
+    int legal_move_count = generate_legal_moves(board, legal_moves);
+
+    if (legal_move_count == 0) {
+        return true; // Checkmate or Stalemate
+    }
+
+    // TODO: Add 50-move rule check (using board->halfmove_clock)
+    // TODO: Add insufficient material check (more complex)
+    // TODO: Add threefold repetition check (requires move history)
+
+    return false;
+}
+
+
+#define QSEARCH_MAX_PLY 16  // Capture sequences longer than this are cut off at the static eval
+#define DELTA_MARGIN    200 // Positional swing a capture may add on top of the material it wins
+
+// Resolves captures below the horizon so leaves are not scored in the middle of
+// an exchange. The side to move may always stand pat on the static eval, so it
+// bounds the score; captures that cannot lift it to the window even with the
+// whole victim won plus DELTA_MARGIN are skipped (delta pruning).
+// Checks are not detected here: a side in check may still stand pat.
+static int quiescence(struct Board *board, int alpha, int beta, bool maximizing_player, int qply) {
+    // Result is discarded by the caller once the search is aborted
+    if (search_should_abort()) return 0;
+    STATS_INC(qnodes);
+
+    int stand_pat = evaluate_board(board);
+    if (maximizing_player) {
+        if (stand_pat >= beta) return stand_pat;
+        if (stand_pat > alpha) alpha = stand_pat;
+    } else {
+        if (stand_pat <= alpha) return stand_pat;
+        if (stand_pat < beta) beta = stand_pat;
+    }
+    if (qply >= QSEARCH_MAX_PLY) return stand_pat;
+
+    struct Move captures[MAX_MOVES];
+    int capture_count = generate_captures(board, captures);
+    score_moves(board, captures, capture_count, 0, MAX_SEARCH_PLY); // MVV-LVA; no killers below the horizon
+    enum PieceColor mover = board->current_player;
+    int best_eval = stand_pat;
+
+    for (int i = 0; i < capture_count; i++) {
+        pick_next_move(captures, capture_count, i);
+        const struct Move *move = &captures[i];
+        enum Piece victim = board->squares[move->to_layer][move->to_row][move->to_col].piece;
+        int gain = piece_values[(victim == EMPTY && move->is_capture) ? PAWN : victim] + DELTA_MARGIN;
+        if (move->promotion != EMPTY) gain += piece_values[move->promotion] - piece_values[PAWN];
+        if (maximizing_player ? stand_pat + gain <= alpha : stand_pat - gain >= beta) continue;
+
+        make_move(board, move);
+        if (is_king_in_check(board, mover)) { // Pseudo-legal only
+            undo_move(board, move);
+            continue;
+        }
+        int eval = quiescence(board, alpha, beta, !maximizing_player, qply + 1);
+        undo_move(board, move);
+        if (search_state.aborted) return 0;
+
+        if (maximizing_player) {
+            if (eval > best_eval) best_eval = eval;
+            if (eval > alpha) alpha = eval;
+        } else {
+            if (eval < best_eval) best_eval = eval;
+            if (eval < beta) beta = eval;
+        }
+        if (beta <= alpha) {
+            STATS_CUTOFF(i);
+            break;
+        }
+    }
+    return best_eval;
+}
+
+int minimax(struct Board *board, int depth, int alpha, int beta, bool maximizing_player) {
+    if (depth == 0) return quiescence(board, alpha, beta, maximizing_player, 0);
+    // Result is discarded by the caller once the search is aborted
+    if (search_should_abort()) return 0;
+    STATS_INC(nodes);
+
+    // Probe the transposition table: a deep enough entry can end the node,
+    // and its best move is searched first either way
+    int alpha_orig = alpha, beta_orig = beta;
+    uint32_t hash_move = 0;
+    struct TTEntry entry;
+    STATS_INC(tt_probes);
+    if (tt_probe(board->hash, &entry)) {
+        STATS_INC(tt_hits);
+        hash_move = entry.move;
+        if (entry.depth >= depth) {
+            if (entry.flag == TT_EXACT) {
+                STATS_INC(tt_cuts);
+                return entry.score;
+            }
+            if (entry.flag == TT_LOWER && entry.score > alpha) alpha = entry.score;
+            if (entry.flag == TT_UPPER && entry.score < beta) beta = entry.score;
+            if (beta <= alpha) {
+                STATS_INC(tt_cuts);
+                return entry.score;
+            }
+        }
+    }
+
+    // One legal move generation serves both the game-over test and the search
+    struct Move legal_moves[MAX_MOVES];
+    int move_count = generate_legal_moves(board, legal_moves);
+
+    if (move_count == 0) {
+        if (is_king_in_check(board, board->current_player)) {
+            return maximizing_player ? -SEARCH_INFINITY : SEARCH_INFINITY; // Checkmated
+        } else {
+            return 0; // Stalemate
+        }
+    }
+    int ply = board->ply - search_root_ply;
+    score_moves(board, legal_moves, move_count, hash_move, ply);
+
+    int best_eval;
+    int best_index = 0;
+    if (maximizing_player) {
+        best_eval = -SEARCH_INFINITY - 1;
+        for (int i = 0; i < move_count; i++) {
+            pick_next_move(legal_moves, move_count, i);
+            make_move(board, &legal_moves[i]);
+            int eval = minimax(board, depth - 1, alpha, beta, false);
+            undo_move(board, &legal_moves[i]);
+            if (search_state.aborted) return 0; // Nothing below is trustworthy; keep it out of the table
+
+            if (eval > best_eval) {
+                best_eval = eval;
+                best_index = i;
+            }
+            alpha = (alpha > eval) ? alpha : eval; // Basic max for alpha
+            if (beta <= alpha) {
+                STATS_CUTOFF(i);
+                record_cutoff(board, &legal_moves[i], depth, ply);
+                break;
+            }
+        }
+    } else { // Minimizing player
+        best_eval = SEARCH_INFINITY + 1;
+        for (int i = 0; i < move_count; i++) {
+            pick_next_move(legal_moves, move_count, i);
+            make_move(board, &legal_moves[i]);
+            int eval = minimax(board, depth - 1, alpha, beta, true);
+            undo_move(board, &legal_moves[i]);
+            if (search_state.aborted) return 0; // Nothing below is trustworthy; keep it out of the table
+
+            if (eval < best_eval) {
+                best_eval = eval;
+                best_index = i;
+            }
+            beta = (beta < eval) ? beta : eval; // Basic min for beta
+            if (beta <= alpha) {
+                STATS_CUTOFF(i);
+                record_cutoff(board, &legal_moves[i], depth, ply);
+                break;
+            }
+        }
+    }
+
+    // Scores outside the original window are only bounds on the true value
+    enum TTFlag flag = TT_EXACT;
+    if (best_eval <= alpha_orig) flag = TT_UPPER;
+    else if (best_eval >= beta_orig) flag = TT_LOWER;
+    tt_store(board->hash, depth, best_eval, flag, encode_move(&legal_moves[best_index]));
+    return best_eval;
+}
+
+
+static double elapsed_ms(struct timespec start) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (now.tv_sec - start.tv_sec) * 1000.0 + (now.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+// --- Parallel Search ---
+// Lazy SMP: every thread runs the same iterative deepening on its own copy of
+// the board. They share only the transposition table, so helpers fill it with
+// results the main thread then finds ready. Odd helpers skip the first depth
+// to keep the threads out of lockstep. The main thread's result is returned
+// and its finishing stops the helpers.
+
+#define SEARCH_THREAD_STACK_SIZE (32 * 1024 * 1024) // A move list per ply lives on the stack
+
+struct SearchThread {
+    struct Board board; // Private copy of the root position
+    const struct SearchLimits *limits;
+    struct timespec start;
+    atomic_bool *stop;
+    int id; // 0 is the main thread
+    struct SearchResult result;
+};
+
+static int search_thread_count = 0; // 0 until set: one per core
+
+static int count_cores(void) {
+#ifdef _WIN32
+    return pthread_num_processors_np(); // winpthreads; avoids dragging windows.h into the engine
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+#endif
+}
+
+void set_search_threads(int count) {
+    if (count < 1) count = 1;
+    if (count > MAX_SEARCH_THREADS) count = MAX_SEARCH_THREADS;
+    search_thread_count = count;
+}
+
+int get_search_threads(void) {
+    if (search_thread_count == 0) set_search_threads(count_cores());
+    return search_thread_count;
+}
+
+// Searches the root at increasing depths until a limit is hit. The previous
+// iteration's best move is searched first, so an interrupted iteration still
+// counts once that move has been searched completely.
+static void search_iterate(struct SearchThread *thread) {
+    struct Board *board = &thread->board;
+    const struct SearchLimits *limits = thread->limits;
+    struct SearchResult *result = &thread->result;
+    struct Move legal_moves[MAX_MOVES];
+    int move_count = generate_legal_moves(board, legal_moves);
+
+    search_state = (struct SearchState){0};
+    search_state.stop = thread->stop;
+    if (thread->id == 0 && limits->max_time_ms > 0) {
+        search_state.deadline = thread->start;
+        search_state.deadline.tv_sec += limits->max_time_ms / 1000;
+        search_state.deadline.tv_nsec += (limits->max_time_ms % 1000) * 1000000L;
+        if (search_state.deadline.tv_nsec >= 1000000000L) {
+            search_state.deadline.tv_sec++;
+            search_state.deadline.tv_nsec -= 1000000000L;
+        }
+        search_state.has_deadline = true;
+    }
+    int max_depth = limits->max_depth;
+    if (max_depth <= 0 || max_depth >= MAX_SEARCH_PLY) {
+        max_depth = (limits->max_time_ms > 0) ? MAX_SEARCH_PLY - 1 : 1;
+    }
+
+    bool is_ai_white = (board->current_player == P_WHITE);
+    reset_move_ordering(board);
+    struct TTEntry entry;
+    uint32_t best_move = tt_probe(board->hash, &entry) ? entry.move : 0;
+
+    // Fall back to the first move if time runs out before depth 1 completes
+    score_moves(board, legal_moves, move_count, best_move, 0);
+    pick_next_move(legal_moves, move_count, 0);
+    result->best_move = legal_moves[0];
+    result->score = evaluate_board(board);
+    result->depth = 0;
+
+    STATS_BEGIN_SEARCH();
+    int first_depth = (thread->id % 2 == 1 && max_depth > 1) ? 2 : 1;
+    for (int depth = first_depth; depth <= max_depth; depth++) {
+        int best_move_index = -1;
+        int best_score = is_ai_white ? -SEARCH_INFINITY - 1 : SEARCH_INFINITY + 1;
+        int alpha = -SEARCH_INFINITY - 1;
+        int beta = SEARCH_INFINITY + 1;
+        STATS_BEGIN_ITERATION(depth);
+        STATS_INC(nodes); // Root
+
+        score_moves(board, legal_moves, move_count, best_move, 0);
+        for (int i = 0; i < move_count; i++) {
+            pick_next_move(legal_moves, move_count, i);
+            make_move(board, &legal_moves[i]);
+            int score = minimax(board, depth - 1, alpha, beta, !is_ai_white);
+            undo_move(board, &legal_moves[i]);
+            if (search_state.aborted) break;
+
+            if (is_ai_white) { // AI is White (maximizing)
+                if (score > best_score) {
+                    best_score = score;
+                    best_move_index = i;
+                }
+                alpha = (alpha > score) ? alpha : score;
+            } else { // AI is Black (minimizing)
+                if (score < best_score) {
+                    best_score = score;
+                    best_move_index = i;
+                }
+                beta = (beta < score) ? beta : score;
+            }
+        }
+        STATS_END_ITERATION();
+
+        if (best_move_index != -1) {
+            result->best_move = legal_moves[best_move_index];
+            result->score = best_score;
+            result->depth = depth;
+            best_move = encode_move(&legal_moves[best_move_index]);
+        }
+        if (search_state.aborted) break;
+        // The root window starts full, so the best score is exact
+        tt_store(board->hash, depth, best_score, TT_EXACT, best_move);
+        if (best_score <= -SEARCH_INFINITY || best_score >= SEARCH_INFINITY) break; // Forced mate found
+    }
+    if (thread->id == 0) STATS_DUMP("3d-chess");
+
+    result->nodes = search_state.nodes;
+}
+
+static void *search_helper_main(void *arg) {
+    search_iterate(arg);
+    return NULL;
+}
+
+bool ai_search(struct Board *board, const struct SearchLimits *limits, struct SearchResult *result) {
+    struct Move legal_moves[MAX_MOVES];
+    if (generate_legal_moves(board, legal_moves) == 0) return false;
+
+    struct timespec start = time_now();
+    atomic_bool stop = false;
+    int thread_count = get_search_threads();
+    // Heap-allocated: each entry carries a whole board with its undo stack
+    struct SearchThread *threads = malloc(sizeof(struct SearchThread) * thread_count);
+    pthread_t *helpers = malloc(sizeof(pthread_t) * thread_count);
+    if (threads == NULL || helpers == NULL) thread_count = 1; // Fall back to searching alone
+
+    struct SearchThread main_thread;
+    struct SearchThread *main_search = (threads != NULL) ? &threads[0] : &main_thread;
+    int helper_count = 0;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, SEARCH_THREAD_STACK_SIZE);
+    for (int t = 0; t < thread_count; t++) {
+        struct SearchThread *thread = (t == 0) ? main_search : &threads[t];
+        thread->board = *board;
+        thread->limits = limits;
+        thread->start = start;
+        thread->stop = &stop;
+        thread->id = t;
+        if (t > 0 && pthread_create(&helpers[helper_count], &attr, search_helper_main, thread) == 0) helper_count++;
+    }
+    pthread_attr_destroy(&attr);
+
+    search_iterate(main_search);
+    atomic_store_explicit(&stop, true, memory_order_relaxed);
+    *result = main_search->result;
+    result->nodes += 1; // Plus the root
+    for (int t = 0; t < helper_count; t++) {
+        pthread_join(helpers[t], NULL);
+        result->nodes += threads[t + 1].result.nodes;
+    }
+    result->time_ms = elapsed_ms(start);
+    free(threads);
+    free(helpers);
+    return true;
+}
+
+void ai_make_move(struct Board *board, int think_time_ms) {
+    struct SearchLimits limits = {0, think_time_ms};
+    struct SearchResult result;
+    if (!ai_search(board, &limits, &result)) {
+        printf("AI has no legal moves!\n");
+        return; // Should be game over
+    }
+
+    const struct Move *move = &result.best_move;
+    printf("AI chooses move from %d,%d,%d to %d,%d,%d (Score: %d, depth %d, %lld nodes, %.0f ms)\n",
+           move->from_layer, move->from_row, move->from_col,
+           move->to_layer, move->to_row, move->to_col,
+           result.score, result.depth, result.nodes, result.time_ms);
+    make_move(board, move);
+}
+
+bool is_move_valid(struct Board *board, const struct Move *move) {
+    struct Move legal_moves[MAX_MOVES];
+    int legal_count = generate_legal_moves(board, legal_moves);
+
+    for (int i = 0; i < legal_count; i++) {
+        if (legal_moves[i].from_layer == move->from_layer &&
+            legal_moves[i].from_row == move->from_row &&
+            legal_moves[i].from_col == move->from_col &&
+            legal_moves[i].to_layer == move->to_layer &&
+            legal_moves[i].to_row == move->to_row &&
+            legal_moves[i].to_col == move->to_col &&
+            legal_moves[i].promotion == move->promotion) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Function to find the king of a specific color
+bool find_king(const struct Board *board, enum PieceColor king_color, int *king_layer, int *king_row, int *king_col) {
+    int sq = board->king_square[king_color];
+    if (sq < 0) return false; // Should not happen in a valid game state
+    *king_layer = sq / BOARD_SQUARES;
+    *king_row = (sq / BOARD_SIZE) % BOARD_SIZE;
+    *king_col = sq % BOARD_SIZE;
+    return true;
+}
+
+// Function to check if the specified king is in check
+bool is_king_in_check(const struct Board *board, enum PieceColor king_color) {
+    int king_layer, king_row, king_col;
+    if (!find_king(board, king_color, &king_layer, &king_row, &king_col)) {
+        return false; // King not found, treat as not in check (error state)
+    }
+    enum PieceColor attacker_color = (king_color == P_WHITE) ? P_BLACK : P_WHITE;
+    return is_square_attacked(board, king_layer, king_row, king_col, attacker_color);
+}
+
+// Function to check if a square is attacked by the opponent
+bool is_square_attacked(const struct Board *board, int target_layer, int target_row, int target_col, enum PieceColor attacker_color) {
+    enum PieceColor defender_color = (attacker_color == P_WHITE) ? P_BLACK : P_WHITE;
+    int target = target_row * BOARD_SIZE + target_col;
+
+    // Pawns, knights and kings: intersect the attack mask with the attacker's pieces on this and the adjacent layers.
+    // A pawn on p attacks the target exactly when a defending pawn on the target would attack p.
+    for (int l = target_layer - 1; l <= target_layer + 1; l++) {
+        if (l < 0 || l >= BOARD_LAYERS) continue;
+        if (pawn_attack_mask[defender_color][target] & board->piece_bb[attacker_color][PAWN][l]) return true;
+        if (knight_mask[target] & board->piece_bb[attacker_color][KNIGHT][l]) return true;
+        uint64_t king_targets = king_mask[target] | ((l != target_layer) ? SQUARE_BIT(target_row, target_col) : 0);
+        if (king_targets & board->piece_bb[attacker_color][KING][l]) return true;
+    }
+
+    // Sliding pieces within the layer
+    uint64_t occupied = layer_occupancy(board, target_layer);
+    uint64_t queens = board->piece_bb[attacker_color][QUEEN][target_layer];
+    if (rook_attacks(target, occupied) & (board->piece_bb[attacker_color][ROOK][target_layer] | queens)) return true;
+    if (bishop_attacks(target, occupied) & (board->piece_bb[attacker_color][BISHOP][target_layer] | queens)) return true;
+
+    // Sliding pieces on the other layers
+    int sq_index = square_index(target_layer, target_row, target_col);
+    for (int d = FLAT_DIRECTIONS; d < NUM_DIRECTIONS; d++) {
+        enum Piece slider = direction_is_diagonal[d] ? BISHOP : ROOK;
+        for (int step = 0; step < ray_length[sq_index][d]; step++) {
+            const struct Square *sq = square_at(board, ray_squares[sq_index][d][step]);
+            if (sq->piece != EMPTY) {
+                if (sq->color == attacker_color && (sq->piece == QUEEN || sq->piece == slider)) return true;
+                break; // Path blocked by a piece (either attacker or defender)
+            }
+        }
+    }
+
+    return false;
+}
+
+// --- Game History ---
+
+#define HISTORY_FILE_VERSION 1
+
+static struct Move unpack_move(uint32_t packed) {
+    int from = packed & 0xFF, to = (packed >> 8) & 0xFF;
+    return (struct Move){from / BOARD_SQUARES, (from / BOARD_SIZE) % BOARD_SIZE, from % BOARD_SIZE,
+                         to / BOARD_SQUARES, (to / BOARD_SIZE) % BOARD_SIZE, to % BOARD_SIZE,
+                         (enum Piece)((packed >> 16) & 0x7), 0, false};
+}
+
+void history_init(struct GameHistory *history, struct Board *board) {
+    history_free(history);
+    init_board(board);
+    history->snapshots = malloc(sizeof(struct Board));
+    if (history->snapshots) history->snapshots[0] = *board;
+}
+
+void history_free(struct GameHistory *history) {
+    free(history->moves);
+    free(history->undo);
+    free(history->snapshots);
+    *history = (struct GameHistory){0};
+}
+
+// Room for one more ply and the snapshot that may follow it
+static bool history_reserve(struct GameHistory *history) {
+    if (history->snapshots == NULL) return false;
+    if (history->length < history->capacity) return true;
+    int capacity = history->capacity ? history->capacity * 2 : 256;
+    uint32_t *moves = realloc(history->moves, capacity * sizeof(uint32_t));
+    if (moves) history->moves = moves;
+    struct PreviousState *undo = realloc(history->undo, capacity * sizeof(struct PreviousState));
+    if (undo) history->undo = undo;
+    struct Board *snapshots = realloc(history->snapshots, (capacity / HISTORY_SNAPSHOT_INTERVAL + 1) * sizeof(struct Board));
+    if (snapshots) history->snapshots = snapshots;
+    if (!moves || !undo || !snapshots) return false;
+    history->capacity = capacity;
+    return true;
+}
+
+bool history_play(struct GameHistory *history, struct Board *board, const struct Move *move) {
+    int length = history->length;
+    history->length = history->current; // Playing from an earlier ply starts a new line
+    if (!history_reserve(history)) {
+        history->length = length; // Nothing played, so the redo tail stays
+        return false;
+    }
+    make_move(board, move);
+    history->moves[history->length] = encode_move(move);
+    history->undo[history->length] = board->undo_stack[(board->ply - 1) % UNDO_STACK_SIZE];
+    history->length++;
+    history->current = history->length;
+    if (history->length % HISTORY_SNAPSHOT_INTERVAL == 0) {
+        history->snapshots[history->length / HISTORY_SNAPSHOT_INTERVAL] = *board;
+    }
+    return true;
+}
+
+bool history_undo(struct GameHistory *history, struct Board *board) {
+    if (history->current == 0) return false;
+    history->current--;
+    struct Move move = unpack_move(history->moves[history->current]);
+    // The ring buffer may have been overwritten by a jump; the log has the original
+    board->undo_stack[(board->ply - 1) % UNDO_STACK_SIZE] = history->undo[history->current];
+    undo_move(board, &move);
+    return true;
+}
+
+bool history_redo(struct GameHistory *history, struct Board *board) {
+    if (history->current >= history->length) return false;
+    struct Move move = unpack_move(history->moves[history->current]);
+    make_move(board, &move);
+    history->current++;
+    return true;
+}
+
+void history_goto(struct GameHistory *history, struct Board *board, int ply) {
+    if (ply < 0) ply = 0;
+    if (ply > history->length) ply = history->length;
+    int distance = (ply > history->current) ? ply - history->current : history->current - ply;
+    if (distance > ply % HISTORY_SNAPSHOT_INTERVAL) { // Closer from the snapshot below the target
+        *board = history->snapshots[ply / HISTORY_SNAPSHOT_INTERVAL];
+        history->current = ply - ply % HISTORY_SNAPSHOT_INTERVAL;
+    }
+    while (history->current < ply) history_redo(history, board);
+    while (history->current > ply) history_undo(history, board);
+}
+
+struct Move history_move(const struct GameHistory *history, int ply) {
+    return unpack_move(history->moves[ply]);
+}
+
+static void write_u32(unsigned char *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (unsigned char)(value >> (8 * i));
+}
+
+static uint32_t read_u32(const unsigned char *in) {
+    return (uint32_t)in[0] | (uint32_t)in[1] << 8 | (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+bool history_save(const struct GameHistory *history, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+    unsigned char header[13] = {'3', 'D', 'C', 'H', HISTORY_FILE_VERSION};
+    write_u32(header + 5, (uint32_t)history->length);
+    write_u32(header + 9, (uint32_t)history->current);
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+    for (int i = 0; ok && i < history->length; i++) {
+        unsigned char packed[3] = {history->moves[i] & 0xFF, (history->moves[i] >> 8) & 0xFF, (history->moves[i] >> 16) & 0xFF};
+        ok = fwrite(packed, sizeof(packed), 1, file) == 1;
+    }
+    return (fclose(file) == 0) && ok;
+}
+
+bool history_load(struct GameHistory *history, struct Board *board, const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return false;
+    unsigned char header[13];
+    bool ok = fread(header, sizeof(header), 1, file) == 1 &&
+              memcmp(header, "3DCH", 4) == 0 && header[4] == HISTORY_FILE_VERSION;
+    uint32_t length = ok ? read_u32(header + 5) : 0;
+    uint32_t current = ok ? read_u32(header + 9) : 0;
+    ok = ok && current <= length;
+
+    // Replayed on the side; the game in progress is only replaced once the whole file checks out
+    struct GameHistory loaded = {0};
+    struct Board loaded_board;
+    history_init(&loaded, &loaded_board);
+    ok = ok && loaded.snapshots != NULL;
+    for (uint32_t i = 0; ok && i < length; i++) {
+        unsigned char packed[3];
+        ok = fread(packed, sizeof(packed), 1, file) == 1;
+        struct Move move = unpack_move((uint32_t)packed[0] | (uint32_t)packed[1] << 8 | (uint32_t)packed[2] << 16);
+        ok = ok && is_move_valid(&loaded_board, &move) && history_play(&loaded, &loaded_board, &move);
+    }
+    fclose(file);
+    if (!ok) {
+        history_free(&loaded); // The current game stays as it was
+        return false;
+    }
+    history_goto(&loaded, &loaded_board, (int)current);
+    history_free(history);
+    *history = loaded;
+    *board = loaded_board;
+    return true;
+}
@@ -0,0 +1,179 @@
+#ifndef THREE_D_CHESS_ENGINE_H
+#define THREE_D_CHESS_ENGINE_H
+
+// 3D chess engine shared by the console front end (threeDChess.c) and the
+// raylib GUI (threeDChess_raylib.c). Board representation, move generation,
+// evaluation and search all live in threeDChessEngine.c; front ends only
+// talk to the functions declared here.
+//
+// Build:
+//   gcc threeDChess.c threeDChessEngine.c -lpthread -o threeDChess.exe
+//   gcc threeDChess_raylib.c threeDChessEngine.c -Iinclude -Llib -lraylib -lopengl32 -lgdi32 -lwinmm -lpthread -o threeDChess_raylib.exe
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h> // For the uint64_t layer bitboards
+
+// --- Constants ---
+#define BOARD_SIZE 8
+#define BOARD_LAYERS 3
+#define MAX_MOVES 512  // Increased for 3D
+#define UNDO_STACK_SIZE 256 // Ring buffer of undo entries, deeper than any search
+#define NUM_SQUARES (BOARD_LAYERS * BOARD_SIZE * BOARD_SIZE) // Square index = layer * 64 + row * 8 + col
+#define NUM_DIRECTIONS 26 // 3D slider directions: 8 within a layer, 9 towards each neighbouring layer
+#define FLAT_DIRECTIONS 8 // The first 8 directions stay within the layer
+#define BOARD_SQUARES (BOARD_SIZE * BOARD_SIZE) // Bits in one layer bitboard
+#define SQUARE_BIT(row, col) (1ULL << ((row) * BOARD_SIZE + (col)))
+#define SEARCH_INFINITY 1000000 // Not INFINITY: that name belongs to math.h
+#define TT_DEFAULT_MB 32 // Transposition table size allocated by the first init_board
+#define MAX_SEARCH_THREADS 64
+
+// --- Game Logic Data Structures ---
+enum Piece {
+    EMPTY, PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING
+};
+
+// Prefixed to avoid conflict with raylib::Color
+enum PieceColor {
+    P_WHITE, P_BLACK, P_NONE
+};
+
+struct Square {
+    enum Piece piece;
+    enum PieceColor color;
+};
+
+struct Move {
+    int from_layer;
+    int from_row;
+    int from_col;
+    int to_layer;
+    int to_row;
+    int to_col;
+    enum Piece promotion;
+    int score; // Used by AI
+    bool is_capture; // Added for potential visual feedback
+};
+
+// Store state needed to undo a move
+struct PreviousState {
+    struct Square captured; // Piece removed by the move (EMPTY if none)
+    int captured_layer;     // Where it stood; differs from the target square for en passant
+    int captured_row;
+    int captured_col;
+    bool white_castle_kingside;
+    bool white_castle_queenside;
+    bool black_castle_kingside;
+    bool black_castle_queenside;
+    int en_passant_layer;
+    int en_passant_row;
+    int en_passant_col;
+    int halfmove_clock;
+    uint64_t hash;
+};
+
+// Front ends may read any field but must only change the board through
+// init_board/make_move/undo_move, which keep the bitboards in step.
+struct Board {
+    struct Square squares[BOARD_LAYERS][BOARD_SIZE][BOARD_SIZE];
+    enum PieceColor current_player;
+    bool white_castle_kingside;
+    bool white_castle_queenside;
+    bool black_castle_kingside;
+    bool black_castle_queenside;
+    int en_passant_layer;
+    int en_passant_row;
+    int en_passant_col;
+    int halfmove_clock;
+    int fullmove_number;
+    int ply; // Moves made since init_board; indexes undo_stack
+    struct PreviousState undo_stack[UNDO_STACK_SIZE]; // Written by make_move, read by undo_move
+    // Bitboards mirroring squares, one uint64_t per layer (bit = row * 8 + col).
+    // Only set_square() writes squares, so the two views never disagree.
+    uint64_t piece_bb[2][KING + 1][BOARD_LAYERS]; // [color][piece][layer]
+    uint64_t color_bb[2][BOARD_LAYERS];           // All pieces of a color
+    uint64_t hash; // Zobrist key: pieces, castling rights, en passant square and side to move
+    int psq_score; // Material + piece-square values, White positive; what evaluate_board() starts from
+    int king_square[2]; // Square index of each king (layer * 64 + row * 8 + col), -1 if it is missing
+};
+
+// Limits for one ai_search. A limit of 0 means "unlimited"; with neither set
+// only depth 1 is searched.
+struct SearchLimits {
+    int max_depth;   // Iterative deepening stops after this depth (plies from the root)
+    int max_time_ms; // Abort once this much wall-clock time has passed
+};
+
+// Outcome of one ai_search call
+struct SearchResult {
+    struct Move best_move;
+    int score;       // White positive, Black negative
+    int depth;       // Deepest iteration that produced best_move
+    long long nodes; // Positions visited, summed over all search threads
+    double time_ms;
+};
+
+// --- Board ---
+void init_board(struct Board *board); // Also builds the attack tables on first use
+bool is_valid_position(int layer, int row, int col);
+void make_move(struct Board *board, const struct Move *move);
+void undo_move(struct Board *board, const struct Move *move); // Reverts the last make_move
+
+// --- Move Generation ---
+void generate_moves_for_piece(const struct Board *board, int layer, int row, int col, struct Move moves[], int *move_count); // Pseudo-legal
+int generate_pseudo_legal_moves(const struct Board *board, struct Move moves[]);
+int generate_legal_moves(struct Board *board, struct Move moves[]); // Board is restored before returning
+long long perft(struct Board *board, int depth); // Legal move paths of this length; checks the generator
+bool is_move_valid(struct Board *board, const struct Move *move); // Legal for the side to move (promotion must match)
+bool is_square_attacked(const struct Board *board, int target_layer, int target_row, int target_col, enum PieceColor attacker_color);
+bool find_king(const struct Board *board, enum PieceColor king_color, int *king_layer, int *king_row, int *king_col);
+bool is_king_in_check(const struct Board *board, enum PieceColor king_color);
+bool is_game_over(struct Board *board); // No legal moves: checkmate or stalemate
+
+// --- Transposition Table ---
+// One table shared by every search and search thread; entries stay valid
+// across moves and games.
+bool tt_resize(size_t megabytes); // Reallocates and clears; false if the allocation failed. Not during a search
+void tt_clear(void);
+
+// --- Search Threads ---
+// ai_search runs this many threads over the shared transposition table (Lazy SMP).
+void set_search_threads(int count); // Clamped to 1..MAX_SEARCH_THREADS
+int get_search_threads(void);       // One per core until set
+
+// --- Evaluation and Search ---
+int evaluate_board(const struct Board *board); // White positive; constant time
+int minimax(struct Board *board, int depth, int alpha, int beta, bool maximizing_player);
+bool ai_search(struct Board *board, const struct SearchLimits *limits, struct SearchResult *result); // false when there is no legal move
+void ai_make_move(struct Board *board, int think_time_ms); // Timed ai_search, print the choice, play it
+
+// --- Game History ---
+// Append-only record of a game from the initial position. Each ply keeps its
+// packed move and the undo information make_move saved, so take-back and redo
+// are a single undo_move/make_move. A board snapshot every
+// HISTORY_SNAPSHOT_INTERVAL plies bounds a jump to any ply to that many moves.
+#define HISTORY_SNAPSHOT_INTERVAL 32
+
+struct GameHistory {
+    uint32_t *moves;            // Packed moves in ply order
+    struct PreviousState *undo; // What make_move saved for each ply
+    struct Board *snapshots;    // Board before ply k * HISTORY_SNAPSHOT_INTERVAL
+    int length;                 // Plies recorded
+    int capacity;               // Plies allocated
+    int current;                // Ply the board is at; below length while reviewing
+};
+
+// The history must be zeroed or previously initialised; init resets the board too
+void history_init(struct GameHistory *history, struct Board *board);
+void history_free(struct GameHistory *history);
+bool history_play(struct GameHistory *history, struct Board *board, const struct Move *move); // Drops any redo tail; false if out of memory
+bool history_undo(struct GameHistory *history, struct Board *board); // false at ply 0
+bool history_redo(struct GameHistory *history, struct Board *board); // false at the end
+void history_goto(struct GameHistory *history, struct Board *board, int ply);
+struct Move history_move(const struct GameHistory *history, int ply); // The move that led from ply to ply + 1
+// Binary file: "3DCH", version byte, length and current ply (32-bit little
+// endian), then 3 bytes per move
+bool history_save(const struct GameHistory *history, const char *path);
+bool history_load(struct GameHistory *history, struct Board *board, const char *path); // Every move is validated; on failure the game is untouched
+
+#endif // THREE_D_CHESS_ENGINE_H
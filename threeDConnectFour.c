@@ -2,9 +2,13 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <string.h>
 #include "include/raylib.h" // Include Raylib header
 #include "include/raymath.h" // Include Raymath header
+#include "connectFour.h" // runParallel, to search the root moves on every core
 
 // Define constants (including those previously in the header)
 #define ROWS 4 // Changed for Sogo-like 4x4x4
@@ -14,9 +18,33 @@
 #define EMPTY 0
 #define HEIGHT 4 // Already 4, but confirming for 4x4x4
 
+// Bitboards: cell (h, r, c) is bit h * 16 + r * 4 + c, so each level is 16 bits
+// and the stack at (r, c) is every 16th bit from r * 4 + c
+#define CELLS3D (HEIGHT * ROWS * COLS)
+#define CELL3D(h, r, c) ((h) * ROWS * COLS + (r) * COLS + (c))
+#define LINE_COUNT3D 76
+#define MAX_CELL_LINES3D 7 // The 8 corners and 8 inner cells lie on 7 lines, the rest on 4
+
+// Search scores, from the AI's side. Wins outweigh any sum of the line terms.
+#define WIN_SCORE3D 100000
+#define EVAL_OPEN_ONE 1        // Line with one of our stones and none of theirs
+#define EVAL_OPEN_TWO 4        // Two of ours, none of theirs
+#define EVAL_OPEN_THREE 16     // Three of ours and an empty cell: a threat
+#define EVAL_DOUBLE_THREAT 64  // Two or more threats; one block can't stop both unless they share the cell
+
+// Besides the stones, make/undo keep each line's stone counts and the evaluation
+// terms that follow from them, touching only the lines through the cell played
+struct Position3D {
+    uint64_t pieces[2];                   // Stones of PLAYER and AI, indexed by piece - 1
+    int moves;                            // Stones played so far
+    uint8_t counts[2][LINE_COUNT3D];      // Stones of each player on each line
+    int lineScore;                        // Open-line terms summed over all lines
+    int openThrees[2];                    // Lines holding three of a player's stones and one empty cell
+};
+
 // Global variables
 int difficulty = 4; // Default AI depth (will be set by user)
-int board3D[HEIGHT][ROWS][COLS]; // Moved global board definition here
+struct Position3D position3D; // The game board
 Camera camera = { 0 }; // Raylib camera
 int currentPlayer = PLAYER;
 bool gameOver = false;
@@ -41,33 +69,41 @@ GameState currentGameState = STATE_SELECT_DIFFICULTY;
 #define DEPTH_MEDIUM 4
 #define DEPTH_HARD 6
 
+// Perfect play: the AI waits this long for the solver's move, then searches at
+// DEPTH_HARD while the solver moves on to the next position
+#define SOLVER_WAIT_SECONDS 5.0
+bool perfectPlay = false;
+double aiTurnStart = 0; // GetTime() when the AI's turn began
+
 // Forward declarations for 3D functions and others used before definition
-bool isFull3D();
+bool isFull3D(const struct Position3D *position);
 void clearInputBuffer();
 void playGame3D(); // Renamed from playGame
 void printBoard3D(); // Added forward declaration
-bool isValidMove3D(int r, int c); // Added forward declaration
-int makeMove3D(int r, int c, int piece); // Added forward declaration
-bool winningMove3D(int piece); // Added forward declaration
+void initLines3D();
+bool isValidMove3D(const struct Position3D *position, int r, int c); // Added forward declaration
+int makeMove3D(struct Position3D *position, int r, int c, int piece); // Added forward declaration
+bool winsAt3D(const struct Position3D *position, int piece, int cell);
+bool winningMove3D(const struct Position3D *position, int piece); // Added forward declaration
+void markWinningLine3D(int piece);
+int pieceAt3D(int h, int r, int c);
 void getBestMove3D(int *bestR, int *bestC); // Added forward declaration
-int minimax3D(int depth, int alpha, int beta, bool maximizing); // Added forward declaration
-int evaluateBoard3D(); // Added forward declaration
-void undoMove3D(int r, int c); // Added forward declaration
+int minimax3D(struct Position3D *position, int depth, int alpha, int beta, bool maximizing); // Added forward declaration
+int evaluateBoard3D(const struct Position3D *position); // Added forward declaration
+void undoMove3D(struct Position3D *position, int r, int c); // Added forward declaration
 void drawBoardRaylib(); // Forward declaration for Raylib drawing function
 void updateGameRaylib(); // Forward declaration for game logic update
 int findLandingHeight(int r, int c); // Helper to find where a piece would land
 
 // ----------------------- 3D CONNECT 4 SECTION -----------------------
 
-// int board3D[HEIGHT][ROWS][COLS]; // Moved higher up
-
 void printBoard3D() {
     printf("\n3D CONNECT 4\n");
     for (int h = 0; h < HEIGHT; h++) {
         printf("Level %d:\n", h);
         for (int r = 0; r < ROWS; r++) {
             for (int c = 0; c < COLS; c++) {
-                printf("| %d ", board3D[h][r][c] == EMPTY ? 0 : board3D[h][r][c]); // Use EMPTY
+                printf("| %d ", pieceAt3D(h, r, c));
             }
             printf("|\n");
         }
@@ -82,239 +118,416 @@ void printBoard3D() {
 
 }
 
-bool isValidMove3D(int r, int c) {
+// Every line of four as a mask, and the lines through each cell, built by initLines3D
+uint64_t lines3D[LINE_COUNT3D];
+int cellLines3D[CELLS3D][MAX_CELL_LINES3D];
+int cellLineCount3D[CELLS3D];
+
+// Builds the line tables; call once before anything else
+void initLines3D() {
+    // One of each pair of opposite directions; every line fits from exactly one end
+    static const int directions[13][3] = {
+        {0, 0, 1}, {0, 1, 0}, {0, 1, 1}, {0, 1, -1},   // Within a level
+        {1, 0, 0},                                     // Vertical stacks
+        {1, 0, 1}, {1, 0, -1}, {1, 1, 0}, {1, -1, 0},  // Diagonals up a vertical plane
+        {1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1} // Space diagonals
+    };
+    int count = 0;
+    memset(cellLineCount3D, 0, sizeof(cellLineCount3D));
+    for (int h = 0; h < HEIGHT; h++) {
+        for (int r = 0; r < ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                for (int i = 0; i < 13; i++) {
+                    int dh = directions[i][0], dr = directions[i][1], dc = directions[i][2];
+                    if (h + 3 * dh >= HEIGHT || r + 3 * dr < 0 || r + 3 * dr >= ROWS ||
+                        c + 3 * dc < 0 || c + 3 * dc >= COLS) continue;
+                    uint64_t line = 0;
+                    for (int k = 0; k < 4; k++) {
+                        int cell = CELL3D(h + k * dh, r + k * dr, c + k * dc);
+                        line |= 1ULL << cell;
+                        cellLines3D[cell][cellLineCount3D[cell]++] = count;
+                    }
+                    lines3D[count++] = line;
+                }
+            }
+        }
+    }
+}
+
+static uint64_t columnMask3D(int r, int c) {
+    return 0x0001000100010001ULL << CELL3D(0, r, c);
+}
+
+// Score of one line from its stone counts: only lines one side alone holds count
+static int lineValue3D(int playerCount, int aiCount) {
+    static const int weights[5] = {0, EVAL_OPEN_ONE, EVAL_OPEN_TWO, EVAL_OPEN_THREE, 0};
+    if (playerCount == 0) return weights[aiCount];
+    if (aiCount == 0) return -weights[playerCount];
+    return 0;
+}
+
+// Adds `delta` (+1 or -1) stones of `piece` at `cell` to the line counts and
+// the terms that depend on them
+static void updateLines3D(struct Position3D *position, int piece, int cell, int delta) {
+    for (int i = 0; i < cellLineCount3D[cell]; i++) {
+        int line = cellLines3D[cell][i];
+        uint8_t *players = &position->counts[0][line], *ais = &position->counts[1][line];
+        position->lineScore -= lineValue3D(*players, *ais);
+        position->openThrees[0] -= (*players == 3 && *ais == 0);
+        position->openThrees[1] -= (*ais == 3 && *players == 0);
+        position->counts[piece - 1][line] += delta;
+        position->lineScore += lineValue3D(*players, *ais);
+        position->openThrees[0] += (*players == 3 && *ais == 0);
+        position->openThrees[1] += (*ais == 3 && *players == 0);
+    }
+}
+
+// PLAYER, AI or EMPTY
+int pieceAt3D(int h, int r, int c) {
+    uint64_t cell = 1ULL << CELL3D(h, r, c);
+    if (position3D.pieces[0] & cell) return PLAYER;
+    if (position3D.pieces[1] & cell) return AI;
+    return EMPTY;
+}
+
+// The move functions take the position to work on: the game's position3D, or
+// a search thread's own copy of it
+
+bool isValidMove3D(const struct Position3D *position, int r, int c) {
     // Check bounds first
     if (r < 0 || r >= ROWS || c < 0 || c >= COLS) {
         return false;
     }
-    // Check if the column is full (bottommost level has a piece) - Changed for bottom-up gravity
-    return board3D[HEIGHT - 1][r][c] == EMPTY; // Use EMPTY
+    // The stack is full once its top level is taken
+    return ((position->pieces[0] | position->pieces[1]) & (1ULL << CELL3D(HEIGHT - 1, r, c))) == 0;
 }
 
+// Drops a piece on the stack at (r, c); returns the height it landed at, -1 if the stack is full
+int makeMove3D(struct Position3D *position, int r, int c, int piece) {
+    int h = __builtin_popcountll((position->pieces[0] | position->pieces[1]) & columnMask3D(r, c));
+    if (h == HEIGHT) return -1;
+    position->pieces[piece - 1] |= 1ULL << CELL3D(h, r, c);
+    position->moves++;
+    updateLines3D(position, piece, CELL3D(h, r, c), 1);
+    return h;
+}
 
-int makeMove3D(int r, int c, int piece) {
-        // Find the lowest available height (h) in the selected (r, c) position - Changed for bottom-up gravity
-    for (int h = 0; h < HEIGHT; h++) { // Iterate from bottom (h=0) upwards
-        if (board3D[h][r][c] == EMPTY) { // Use EMPTY
-            board3D[h][r][c] = piece;
-            return h; // Return the height where the piece was placed
-        }
+// Removes the top piece of the stack at (r, c)
+void undoMove3D(struct Position3D *position, int r, int c) {
+    int h = __builtin_popcountll((position->pieces[0] | position->pieces[1]) & columnMask3D(r, c)) - 1;
+    if (h < 0) return;
+    uint64_t cell = 1ULL << CELL3D(h, r, c);
+    int piece = (position->pieces[0] & cell) ? PLAYER : AI;
+    position->pieces[piece - 1] &= ~cell;
+    position->moves--;
+    updateLines3D(position, piece, CELL3D(h, r, c), -1);
+}
+
+// True if `piece` has four in a row through `cell`, e.g. the cell just played
+bool winsAt3D(const struct Position3D *position, int piece, int cell) {
+    for (int i = 0; i < cellLineCount3D[cell]; i++) {
+        if (position->counts[piece - 1][cellLines3D[cell][i]] == 4) return true;
     }
-    return -1; // Should not happen if isValidMove3D was checked
+    return false;
 }
 
+bool winningMove3D(const struct Position3D *position, int piece) {
+    for (int i = 0; i < LINE_COUNT3D; i++) {
+        if (position->counts[piece - 1][i] == 4) return true;
+    }
+    return false;
+}
 
-void undoMove3D(int r, int c) {
-    // Find the highest piece in the column (r, c) and remove it - Changed for bottom-up gravity
-    // This actually needs to find the highest piece to remove the last placed one.
-    for (int h = HEIGHT - 1; h >= 0; h--) { // Iterate from top down
-        if (board3D[h][r][c] != EMPTY) { // Use EMPTY
-            board3D[h][r][c] = EMPTY; // Use EMPTY
-            break; // Remove only the top-most piece in the stack
-        }
+// Stores the winning line of `piece` on the game board for drawing; the
+// line's lowest and highest bits are its two ends
+void markWinningLine3D(int piece) {
+    for (int i = 0; i < LINE_COUNT3D; i++) {
+        if (position3D.counts[piece - 1][i] != 4) continue;
+        int first = __builtin_ctzll(lines3D[i]);
+        int last = 63 - __builtin_clzll(lines3D[i]);
+        winStartH = first / (ROWS * COLS); winStartR = first / COLS % ROWS; winStartC = first % COLS;
+        winDirH = (last / (ROWS * COLS) - winStartH) / 3;
+        winDirR = (last / COLS % ROWS - winStartR) / 3;
+        winDirC = (last % COLS - winStartC) / 3;
+        return;
     }
 }
 
-// Comprehensive check for 4-in-a-row in 3D
-bool winningMove3D(int piece) {
-    // Reset winning line info at the start of check
-    winStartH = -1; winStartR = -1; winStartC = -1;
-    winDirH = 0; winDirR = 0; winDirC = 0;
-
-    // Check all possible lines of 4 (horizontal, vertical, depth-wise, and all diagonals)
-    for (int h = 0; h < HEIGHT; ++h) {
-        for (int r = 0; r < ROWS; ++r) {
-            for (int c = 0; c < COLS; ++c) {
-                // Check lines starting from (h, r, c) in all 13 directions in 3D space
-                // (Only need to check directions where coordinates increase or stay same,
-                // as other directions are covered by starting from different points)
-
-                 // Simplified directions (check only positive/zero directions from each point)
-                 int simplified_directions[13][3] = {
-                    // Within a plane (h constant)
-                    {0, 0, 1},  // --> (Horizontal)
-                    {0, 1, 0},  // | (Vertical)
-                    {0, 1, 1},  // / (Diagonal up-right)
-                    {0, 1, -1}, // \\ (Diagonal up-left) - Need this one explicitly
-
-                    // Vertical columns
-                    {1, 0, 0},  // Upwards
-
-                    // Diagonals involving height change
-                    {1, 0, 1},  // Up-forward
-                    {1, 0, -1}, // Up-backward
-                    {1, 1, 0},  // Up-right (vertical plane)
-                    {1, -1, 0}, // Up-left (vertical plane)
-                    {1, 1, 1},  // 3D diagonal (all increasing)
-                    {1, 1, -1}, // 3D diagonal
-                    {1, -1, 1}, // 3D diagonal
-                    {1, -1, -1} // 3D diagonal
-                };
-
-
-                for (int i = 0; i < 13; ++i) {
-                    int dh = simplified_directions[i][0];
-                    int dr = simplified_directions[i][1];
-                    int dc = simplified_directions[i][2];
-
-                    // Check if the line fits within the board boundaries
-                    if (h + 3 * dh >= 0 && h + 3 * dh < HEIGHT &&
-                        r + 3 * dr >= 0 && r + 3 * dr < ROWS &&
-                        c + 3 * dc >= 0 && c + 3 * dc < COLS)
-                    {
-                        // Check if all 4 pieces match
-                        if (board3D[h][r][c] == piece &&
-                            board3D[h + dh][r + dr][c + dc] == piece &&
-                            board3D[h + 2 * dh][r + 2 * dr][c + 2 * dc] == piece &&
-                            board3D[h + 3 * dh][r + 3 * dr][c + 3 * dc] == piece)
-                        {
-                            // Store winning line info
-                            winStartH = h;
-                            winStartR = r;
-                            winStartC = c;
-                            winDirH = dh;
-                            winDirR = dr;
-                            winDirC = dc;
-                            return true;
-                        }
-                    }
-                }
-            }
+
+// Heuristic for the depth limit, read off the terms make/undo keep up to date;
+// minimax3D never reaches a won position
+int evaluateBoard3D(const struct Position3D *position) {
+    int doubleThreats = (position->openThrees[1] >= 2) - (position->openThrees[0] >= 2);
+    return position->lineScore + EVAL_DOUBLE_THREAT * doubleThreats;
+}
+
+// --- Transposition Table ---
+// Shared by all search threads without locks, like the chess engine's: each
+// slot holds the packed entry and key ^ data, so a slot torn by two threads
+// writing at once no longer verifies and a probe simply misses. Keys are
+// computed from the position's canonical image under the 8 symmetries of the
+// square (applied to every level alike; they keep gravity), so a position and
+// its rotations and reflections share one entry.
+
+#define TT_SLOTS3D (1 << 20) // 16 MB
+
+enum TTFlag3D { TT_EXACT3D, TT_LOWER3D, TT_UPPER3D }; // Bound type of the stored score
+
+// Unpacked view of a slot
+struct TTEntry3D {
+    int move;  // Best stack r * COLS + c in the canonical image, -1 if none
+    int score; // Wins stored relative to the node, see scoreToTT3D
+    int depth;
+    enum TTFlag3D flag;
+};
+
+struct TTSlot3D {
+    _Atomic uint64_t check; // key ^ data
+    _Atomic uint64_t data;  // move + 1 (bits 0-7) | score (8-39) | depth (40-47) | flag (48-49)
+};
+
+static struct TTSlot3D ttSlots3D[TT_SLOTS3D];
+
+// Each 16-bit lane of a bitboard is one level, bit r * 4 + c, so these move
+// every level at once
+static uint64_t mirrorColumns3D(uint64_t x) {
+    x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+    return ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+}
+
+static uint64_t mirrorRows3D(uint64_t x) {
+    x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return ((x >> 8) & 0x00FF00FF00FF00FFULL) | ((x & 0x00FF00FF00FF00FFULL) << 8);
+}
+
+// Swaps r and c: first within each 2x2 block, then the off-diagonal blocks
+static uint64_t transpose3D(uint64_t x) {
+    uint64_t t = (x ^ (x >> 3)) & 0x0A0A0A0A0A0A0A0AULL;
+    x ^= t ^ (t << 3);
+    t = (x ^ (x >> 6)) & 0x00CC00CC00CC00CCULL;
+    return x ^ t ^ (t << 6);
+}
+
+static uint64_t mix3D(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Hash of the least of the 8 images of the position (by PLAYER's stones, then
+// the AI's). *symmetry gets the image used: bit 2 transposes, then bit 0
+// mirrors the columns and bit 1 the rows.
+static uint64_t canonicalKey3D(const struct Position3D *position, bool aiToMove, int *symmetry) {
+    uint64_t images[2][8];
+    for (int p = 0; p < 2; p++) {
+        uint64_t x = position->pieces[p];
+        for (int t = 0; t < 8; t += 4) {
+            images[p][t] = x;
+            images[p][t + 1] = mirrorColumns3D(x);
+            images[p][t + 2] = mirrorRows3D(x);
+            images[p][t + 3] = mirrorRows3D(images[p][t + 1]);
+            x = transpose3D(x);
         }
     }
-    return false; // No winning line found
+    int best = 0;
+    for (int s = 1; s < 8; s++) {
+        if (images[0][s] < images[0][best] || (images[0][s] == images[0][best] && images[1][s] < images[1][best])) best = s;
+    }
+    *symmetry = best;
+    return mix3D(images[0][best] ^ mix3D(images[1][best])) ^ (aiToMove ? 0x9E3779B97F4A7C15ULL : 0);
 }
 
+// Stack r * COLS + c to its place in the image, and back
+static int toImage3D(int stack, int symmetry) {
+    int r = stack / COLS, c = stack % COLS;
+    if (symmetry & 4) { int t = r; r = c; c = t; }
+    if (symmetry & 1) c = COLS - 1 - c;
+    if (symmetry & 2) r = ROWS - 1 - r;
+    return r * COLS + c;
+}
 
-// Basic evaluation for 3D
-int evaluateBoard3D() {
-     if (winningMove3D(AI)) return 100;
-     if (winningMove3D(PLAYER)) return -100;
-     return 0;
+static int fromImage3D(int stack, int symmetry) {
+    int r = stack / COLS, c = stack % COLS;
+    if (symmetry & 2) r = ROWS - 1 - r;
+    if (symmetry & 1) c = COLS - 1 - c;
+    if (symmetry & 4) { int t = r; r = c; c = t; }
+    return r * COLS + c;
 }
 
-int minimax3D(int depth, int alpha, int beta, bool maximizing) {
-    if (winningMove3D(PLAYER)) return -100 - depth; // Prioritize faster wins/losses
-    if (winningMove3D(AI)) return 100 + depth;
-    if (isFull3D()) return 0;
-    if (depth == 0) return evaluateBoard3D();
+// A win's score counts the depth left where it was found; stored relative to
+// the node instead, so the entry holds at any depth
+static int scoreToTT3D(int score, int depth) {
+    if (score > WIN_SCORE3D / 2) return score - depth;
+    if (score < -WIN_SCORE3D / 2) return score + depth;
+    return score;
+}
 
-    if (maximizing) {
-        int maxEval = INT_MIN;
-        for (int r = 0; r < ROWS; r++) {
-            for (int c = 0; c < COLS; c++) {
-                if (isValidMove3D(r, c)) {
-                    int h = makeMove3D(r, c, AI); // Need height for potential undo optimization later if needed
-                    if (h != -1) { // Check if move was actually made
-                        int eval = minimax3D(depth - 1, alpha, beta, false);
-                        undoMove3D(r, c);
-                        maxEval = eval > maxEval ? eval : maxEval;
-                        alpha = alpha > eval ? alpha : eval;
-                        if (beta <= alpha)
-                            goto end_maximizing_loop; // Use goto for breaking nested loops
-                    }
-                }
-            }
+static int scoreFromTT3D(int score, int depth) {
+    if (score > WIN_SCORE3D / 2) return score + depth;
+    if (score < -WIN_SCORE3D / 2) return score - depth;
+    return score;
+}
+
+static bool ttProbe3D(uint64_t key, struct TTEntry3D *out) {
+    struct TTSlot3D *slot = &ttSlots3D[key & (TT_SLOTS3D - 1)];
+    uint64_t data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    uint64_t check = atomic_load_explicit(&slot->check, memory_order_relaxed);
+    if ((check ^ data) != key) return false;
+    out->move = (int)(data & 0xFF) - 1;
+    out->score = (int32_t)(uint32_t)(data >> 8);
+    out->depth = (int)((data >> 40) & 0xFF);
+    out->flag = (enum TTFlag3D)((data >> 48) & 3);
+    return true;
+}
+
+// Depth-preferred within one position; a different position always takes the slot
+static void ttStore3D(uint64_t key, int depth, int score, enum TTFlag3D flag, int move) {
+    struct TTSlot3D *slot = &ttSlots3D[key & (TT_SLOTS3D - 1)];
+    uint64_t oldData = atomic_load_explicit(&slot->data, memory_order_relaxed);
+    uint64_t oldCheck = atomic_load_explicit(&slot->check, memory_order_relaxed);
+    if ((oldCheck ^ oldData) == key && (int)((oldData >> 40) & 0xFF) > depth) return;
+    uint64_t data = (uint64_t)(move + 1) | (uint64_t)(uint32_t)score << 8 | (uint64_t)depth << 40 | (uint64_t)flag << 48;
+    atomic_store_explicit(&slot->data, data, memory_order_relaxed);
+    atomic_store_explicit(&slot->check, key ^ data, memory_order_relaxed);
+}
+
+// Moves are tried best-looking first for the side to move: the transposition
+// table's move, then by the evaluation after each, which make/undo keep current
+// for the cost of the move itself. A move that completes four is scored on the
+// spot, checking only the lines through the placed piece, so nodes never start
+// from a won position.
+int minimax3D(struct Position3D *position, int depth, int alpha, int beta, bool maximizing) {
+    if (isFull3D(position)) return 0;
+    if (depth == 0) return evaluateBoard3D(position);
+
+    // A deep enough entry can end the node; its move is searched first either way
+    int alphaOrig = alpha, betaOrig = beta;
+    int symmetry;
+    uint64_t key = canonicalKey3D(position, maximizing, &symmetry);
+    int hashMove = -1;
+    struct TTEntry3D entry;
+    if (ttProbe3D(key, &entry)) {
+        if (entry.move >= 0) hashMove = fromImage3D(entry.move, symmetry);
+        if (entry.depth >= depth) {
+            int score = scoreFromTT3D(entry.score, depth);
+            if (entry.flag == TT_EXACT3D) return score;
+            if (entry.flag == TT_LOWER3D && score > alpha) alpha = score;
+            if (entry.flag == TT_UPPER3D && score < beta) beta = score;
+            if (beta <= alpha) return score;
         }
-    end_maximizing_loop:;
-        return maxEval;
-    } else {
-        int minEval = INT_MAX;
-        for (int r = 0; r < ROWS; r++) {
-            for (int c = 0; c < COLS; c++) {
-                if (isValidMove3D(r, c)) {
-                     int h = makeMove3D(r, c, PLAYER);
-                     if (h != -1) {
-                        int eval = minimax3D(depth - 1, alpha, beta, true);
-                        undoMove3D(r, c);
-                        minEval = eval < minEval ? eval : minEval;
-                        beta = beta < eval ? beta : eval;
-                        if (beta <= alpha)
-                             goto end_minimizing_loop; // Use goto for breaking nested loops
-                    }
-                }
+    }
+
+    int piece = maximizing ? AI : PLAYER;
+    int sign = maximizing ? 1 : -1;
+    int moves[ROWS * COLS], keys[ROWS * COLS];
+    int count = 0;
+    for (int r = 0; r < ROWS; r++) {
+        for (int c = 0; c < COLS; c++) {
+            int h = makeMove3D(position, r, c, piece);
+            if (h == -1) continue;
+            bool wins = winsAt3D(position, piece, CELL3D(h, r, c));
+            int order = (r * COLS + c == hashMove) ? INT_MAX : sign * evaluateBoard3D(position);
+            undoMove3D(position, r, c);
+            if (wins) return sign * (WIN_SCORE3D + depth - 1); // Prioritize faster wins/losses
+            int k = count++;
+            for (; k > 0 && keys[k - 1] < order; k--) {
+                moves[k] = moves[k - 1];
+                keys[k] = keys[k - 1];
             }
+            moves[k] = r * COLS + c;
+            keys[k] = order;
+        }
+    }
+
+    int best = maximizing ? INT_MIN : INT_MAX;
+    int bestMove = moves[0];
+    for (int i = 0; i < count; i++) {
+        int r = moves[i] / COLS, c = moves[i] % COLS;
+        makeMove3D(position, r, c, piece);
+        int eval = minimax3D(position, depth - 1, alpha, beta, !maximizing);
+        undoMove3D(position, r, c);
+        if (maximizing ? eval > best : eval < best) {
+            best = eval;
+            bestMove = moves[i];
         }
-     end_minimizing_loop:;
-        return minEval;
+        if (maximizing) alpha = alpha > eval ? alpha : eval;
+        else beta = beta < eval ? beta : eval;
+        if (beta <= alpha)
+            break;
+    }
+
+    enum TTFlag3D flag = TT_EXACT3D;
+    if (best <= alphaOrig) flag = TT_UPPER3D;
+    else if (best >= betaOrig) flag = TT_LOWER3D;
+    ttStore3D(key, depth, scoreToTT3D(best, depth), flag, toImage3D(bestMove, symmetry));
+    return best;
+}
+
+// Root moves of one AI turn, searched in parallel, each thread on its own copy
+// of the position. The threads share the best score so far as alpha; a move whose
+// score beat the alpha its search started with has an exact score.
+struct RootSearch3D {
+    struct Position3D position;
+    int moves[ROWS * COLS]; // r * COLS + c
+    int scores[ROWS * COLS];
+    bool exact[ROWS * COLS];
+    atomic_int alpha;
+};
+
+static void searchRootMove3D(void *context, int index) {
+    struct RootSearch3D *root = context;
+    struct Position3D position = root->position;
+    makeMove3D(&position, root->moves[index] / COLS, root->moves[index] % COLS, AI);
+
+    int alpha = atomic_load_explicit(&root->alpha, memory_order_relaxed);
+    int score = minimax3D(&position, difficulty, alpha, INT_MAX, false);
+    root->scores[index] = score;
+    root->exact[index] = score > alpha;
+    while (score > alpha && !atomic_compare_exchange_weak(&root->alpha, &alpha, score)) {
     }
 }
 
 void getBestMove3D(int *bestR, int *bestC) {
-    int bestScore = INT_MIN;
     *bestR = -1; // Initialize to invalid
     *bestC = -1;
 
+    struct RootSearch3D root = {.position = position3D, .alpha = INT_MIN};
+    int moveCount = 0;
     for (int r = 0; r < ROWS; r++) {
         for (int c = 0; c < COLS; c++) {
-            if (isValidMove3D(r, c)) {
-                 // Check for immediate AI win
-                int h_win = makeMove3D(r, c, AI);
-                if (h_win != -1) {
-                    if (winningMove3D(AI)) {
-                        undoMove3D(r, c);
-                        *bestR = r;
-                        *bestC = c;
-                        return; // Found winning move
-                    }
-                    undoMove3D(r, c);
-                }
-
-                 // Check for immediate Player win to block
-                 int h_block = makeMove3D(r, c, PLAYER);
-                 if (h_block != -1) {
-                     if (winningMove3D(PLAYER)) {
-                         undoMove3D(r, c);
-                         *bestR = r; // Prioritize blocking
-                         *bestC = c;
-                         bestScore = INT_MAX - 1; // High score, but less than immediate win
-                         continue; // Check other moves in case AI can win immediately elsewhere
-                     }
-                     undoMove3D(r, c);
-                 }
-
-
-                // Run minimax if not blocking an immediate player win
-                 if (*bestR != r || *bestC != c || bestScore < INT_MAX -1) {
-                    int h_eval = makeMove3D(r, c, AI);
-                    if (h_eval != -1) {
-                        int score = minimax3D(difficulty, INT_MIN, INT_MAX, false);
-                        undoMove3D(r, c);
-                        if (score > bestScore) {
-                            bestScore = score;
-                            *bestR = r;
-                            *bestC = c;
-                        } else if (*bestR == -1) { // Ensure a move is chosen
-                             *bestR = r;
-                             *bestC = c;
-                        }
-                    }
-                 }
-            }
+            if (isValidMove3D(&root.position, r, c)) root.moves[moveCount++] = r * COLS + c;
         }
     }
-     // If no move found (e.g., board full, though isFull3D should catch this)
-     // Or if all moves lead to loss and bestR/bestC remain -1
-    if (*bestR == -1 || *bestC == -1) {
-        for (int r = 0; r < ROWS; ++r) {
-            for (int c = 0; c < COLS; ++c) {
-                if (isValidMove3D(r, c)) {
-                    *bestR = r;
-                    *bestC = c;
-                    return;
-                }
+    if (moveCount == 0) return;
+
+    // Check for an immediate AI win, then for a player win to block
+    int pieces[2] = {AI, PLAYER};
+    for (int p = 0; p < 2; p++) {
+        for (int i = 0; i < moveCount; i++) {
+            int r = root.moves[i] / COLS, c = root.moves[i] % COLS;
+            int h = makeMove3D(&root.position, r, c, pieces[p]);
+            bool wins = winsAt3D(&root.position, pieces[p], CELL3D(h, r, c));
+            undoMove3D(&root.position, r, c);
+            if (wins) {
+                *bestR = r;
+                *bestC = c;
+                return;
             }
         }
     }
+
+    runParallel(moveCount, searchRootMove3D, &root);
+    int best = -1; // Ties go to the first move in board order
+    for (int i = 0; i < moveCount; i++) {
+        if (root.exact[i] && (best == -1 || root.scores[i] > root.scores[best])) best = i;
+    }
+    *bestR = root.moves[best] / COLS;
+    *bestC = root.moves[best] % COLS;
 }
 
 
-bool isFull3D() {
-    for (int r = 0; r < ROWS; r++) // Check top level only is sufficient
-        for (int c = 0; c < COLS; c++)
-            if (board3D[0][r][c] == EMPTY)
-                return false;
-    return true;
+bool isFull3D(const struct Position3D *position) {
+    return position->moves == CELLS3D;
 }
 
 // Function to clear the input buffer
@@ -326,12 +539,397 @@ void clearInputBuffer() {
 // Helper function to find the lowest empty slot (height) in a column
 int findLandingHeight(int r, int c) {
     if (r < 0 || r >= ROWS || c < 0 || c >= COLS) return -1; // Bounds check
-    for (int h = 0; h < HEIGHT; h++) { // Iterate bottom-up
-        if (board3D[h][r][c] == EMPTY) {
-            return h;
+    int h = __builtin_popcountll((position3D.pieces[0] | position3D.pieces[1]) & columnMask3D(r, c));
+    return (h < HEIGHT) ? h : -1; // -1 if the column is full
+}
+
+// ----------------------- PROOF-NUMBER SOLVER -----------------------
+// Exact result of a position under perfect play, found by depth-first
+// proof-number search (df-pn) on a background thread while the game goes on.
+// Proof-number search settles a yes/no question, so a solve asks two: can the
+// side to move force a win, and if not, can the opponent? A no to both is a
+// draw.
+//
+// Every node is scored for its side to move by phi and delta, the proof and
+// disproof numbers of that side's goal (a win for the side asking, anything
+// but a loss for the other): how many leaves would still have to be settled to
+// prove or refute it. Searching always the child that is cheapest to settle,
+// only as long as it stays within the thresholds its parent can afford, df-pn
+// needs no tree in memory, just a table of the numbers. Stones are only ever
+// added, so positions never repeat and the numbers need no history.
+//
+// The table is bounded by the memory cap: 16-byte entries in buckets of four,
+// keyed like the search's transposition table so symmetric positions share an
+// entry. A full bucket gives up its cheapest entry; settled ones are kept over
+// open ones. It is kept between solves, so each solve after a move starts from
+// the work done on the positions before it.
+
+#define DFPN_INFINITY ((1u << 28) - 1)  // phi and delta are 28-bit
+#define DFPN_BUCKET 4
+#define SOLVER_MEMORY_MB 64              // Default table size
+
+enum SolveResult3D { SOLVE_UNKNOWN, SOLVE_WIN, SOLVE_LOSS, SOLVE_DRAW }; // For the side to move
+
+struct SolverProgress3D {
+    bool running;
+    int sideToMove;         // At the position being solved: PLAYER or AI
+    int question;           // 1 while asking whether the side to move wins, 2 whether the opponent does
+    enum SolveResult3D result;
+    int plies;              // Stones until the game ends along the proof, the last one included; an upper bound
+    int move;               // Best stack r * COLS + c once solved
+    long long nodes;
+    size_t entries, capacity;
+};
+
+struct DfpnResult3D {
+    uint32_t phi, delta;
+    int plies; // Meaningful once phi or delta is 0
+};
+
+struct DfpnEntry3D {
+    uint64_t key;  // 0 when empty
+    uint64_t data; // phi (bits 0-27) | delta (28-55) | plies (56-63)
+};
+
+static struct DfpnEntry3D *dfpnTable3D;
+static size_t dfpnBuckets3D;
+static size_t solverMemoryMb3D = SOLVER_MEMORY_MB;
+static int dfpnAttacker3D; // Side whose win is being asked about
+
+static pthread_t solverThread3D;
+static bool solverStarted3D; // solverThread3D needs joining
+static struct Position3D solverRoot3D;
+static atomic_bool solverStop3D, solverRunning3D;
+static atomic_int solverQuestion3D;
+static _Atomic long long solverNodes3D;
+static atomic_size_t dfpnEntries3D;
+// Written by the solver thread before it clears solverRunning3D
+static enum SolveResult3D solverResult3D;
+static int solverPlies3D, solverMove3D;
+
+static int sideToMove3D(const struct Position3D *position) {
+    return (position->moves & 1) ? AI : PLAYER; // The player always moves first
+}
+
+// The cell each stack's next stone lands on, for every stack not yet full
+static uint64_t landingCells3D(const struct Position3D *position) {
+    uint64_t occupied = position->pieces[0] | position->pieces[1];
+    return ~occupied & ((occupied << (ROWS * COLS)) | ((1ULL << (ROWS * COLS)) - 1));
+}
+
+// Landing cells where a stone of `piece` completes four
+static uint64_t winningCells3D(const struct Position3D *position, int piece) {
+    uint64_t cells = 0;
+    for (uint64_t landing = landingCells3D(position); landing; landing &= landing - 1) {
+        int cell = __builtin_ctzll(landing);
+        for (int i = 0; i < cellLineCount3D[cell]; i++) {
+            if (position->counts[piece - 1][cellLines3D[cell][i]] == 3) {
+                cells |= 1ULL << cell;
+                break;
+            }
+        }
+    }
+    return cells;
+}
+
+static struct DfpnResult3D dfpnSettled3D(bool reached, int plies) {
+    return reached ? (struct DfpnResult3D){0, DFPN_INFINITY, plies} : (struct DfpnResult3D){DFPN_INFINITY, 0, plies};
+}
+
+// Settles the node on the spot if it can be, else gives the landing cells
+// worth searching: only the block when the opponent threatens a single win
+static bool dfpnTerminal3D(const struct Position3D *position, struct DfpnResult3D *result, uint64_t *moves) {
+    int side = sideToMove3D(position), other = PLAYER + AI - side;
+    if (winningCells3D(position, side)) {
+        *result = dfpnSettled3D(true, 1);
+        return true;
+    }
+    if (isFull3D(position)) {
+        *result = dfpnSettled3D(side != dfpnAttacker3D, 0); // A draw is a loss only to the side asking for a win
+        return true;
+    }
+    uint64_t threats = winningCells3D(position, other);
+    if (threats & (threats - 1)) {
+        *result = dfpnSettled3D(false, 2); // Two threats and one stone to block with
+        return true;
+    }
+    *moves = threats ? threats : landingCells3D(position);
+    return false;
+}
+
+static uint64_t dfpnKey3D(const struct Position3D *position) {
+    int symmetry;
+    uint64_t key = canonicalKey3D(position, sideToMove3D(position) == AI, &symmetry);
+    if (dfpnAttacker3D == AI) key ^= 0xD6E8FEB86659FD93ULL; // Each question has its own entries
+    return key ? key : 1;
+}
+
+static bool dfpnProbe3D(uint64_t key, struct DfpnResult3D *out) {
+    struct DfpnEntry3D *bucket = &dfpnTable3D[(key % dfpnBuckets3D) * DFPN_BUCKET];
+    for (int i = 0; i < DFPN_BUCKET; i++) {
+        if (bucket[i].key != key) continue;
+        uint64_t data = bucket[i].data;
+        *out = (struct DfpnResult3D){(uint32_t)(data & DFPN_INFINITY), (uint32_t)((data >> 28) & DFPN_INFINITY), (int)(data >> 56)};
+        return true;
+    }
+    return false;
+}
+
+// Rough worth of keeping an entry: settled results first, the deepest proofs
+// among them, then the open nodes that took the most work to score
+static uint64_t dfpnWorth3D(uint64_t data) {
+    uint64_t phi = data & DFPN_INFINITY, delta = (data >> 28) & DFPN_INFINITY;
+    if (phi == 0 || delta == 0) return (1ULL << 40) + (data >> 56);
+    return phi + delta;
+}
+
+static void dfpnStore3D(uint64_t key, struct DfpnResult3D result) {
+    struct DfpnEntry3D *bucket = &dfpnTable3D[(key % dfpnBuckets3D) * DFPN_BUCKET];
+    uint64_t data = result.phi | (uint64_t)result.delta << 28 | (uint64_t)result.plies << 56;
+    struct DfpnEntry3D *victim = &bucket[0];
+    for (int i = 0; i < DFPN_BUCKET; i++) {
+        if (bucket[i].key == key) {
+            victim = &bucket[i];
+            break;
+        }
+        if (bucket[i].key == 0) {
+            if (victim->key != 0) victim = &bucket[i];
+        } else if (victim->key != 0 && dfpnWorth3D(bucket[i].data) < dfpnWorth3D(victim->data)) {
+            victim = &bucket[i];
+        }
+    }
+    if (victim->key == 0) atomic_fetch_add_explicit(&dfpnEntries3D, 1, memory_order_relaxed);
+    victim->key = key;
+    victim->data = data;
+}
+
+static void playCell3D(struct Position3D *position, int cell, int piece) {
+    int stack = cell % (ROWS * COLS);
+    makeMove3D(position, stack / COLS, stack % COLS, piece);
+}
+
+static void undoCell3D(struct Position3D *position, int cell) {
+    int stack = cell % (ROWS * COLS);
+    undoMove3D(position, stack / COLS, stack % COLS);
+}
+
+static uint32_t dfpnClamp3D(uint64_t x) {
+    return x < DFPN_INFINITY ? (uint32_t)x : DFPN_INFINITY;
+}
+
+// Searches until phi reaches thPhi or delta reaches thDelta. A node's phi is
+// the least delta of its children (one refuted reply proves it), its delta the
+// sum of their phis (every reply has to hold).
+static struct DfpnResult3D dfpnSearch3D(struct Position3D *position, uint32_t thPhi, uint32_t thDelta) {
+    atomic_fetch_add_explicit(&solverNodes3D, 1, memory_order_relaxed);
+    struct DfpnResult3D result;
+    uint64_t moves;
+    if (dfpnTerminal3D(position, &result, &moves)) return result;
+    uint64_t key = dfpnKey3D(position);
+    if (dfpnProbe3D(key, &result) && (result.phi >= thPhi || result.delta >= thDelta)) return result;
+
+    // Children settled on the spot never reach the table, so keep their results here
+    int side = sideToMove3D(position);
+    int cells[ROWS * COLS], count = 0;
+    uint64_t keys[ROWS * COLS];
+    bool settled[ROWS * COLS];
+    struct DfpnResult3D children[ROWS * COLS];
+    for (; moves; moves &= moves - 1, count++) {
+        uint64_t childMoves;
+        cells[count] = __builtin_ctzll(moves);
+        playCell3D(position, cells[count], side);
+        settled[count] = dfpnTerminal3D(position, &children[count], &childMoves);
+        if (!settled[count]) keys[count] = dfpnKey3D(position);
+        undoCell3D(position, cells[count]);
+    }
+
+    for (;;) {
+        uint32_t secondDelta = DFPN_INFINITY, bestPhi = 1;
+        uint64_t delta = 0;
+        int best = 0, proof = INT_MAX, longest = 0;
+        result.phi = DFPN_INFINITY;
+        for (int i = 0; i < count; i++) {
+            struct DfpnResult3D child = children[i];
+            if (!settled[i] && !dfpnProbe3D(keys[i], &child)) child = (struct DfpnResult3D){1, 1, 0};
+            if (child.delta < result.phi) {
+                secondDelta = result.phi;
+                result.phi = child.delta;
+                bestPhi = child.phi;
+                best = i;
+            } else if (child.delta < secondDelta) {
+                secondDelta = child.delta;
+            }
+            delta += child.phi;
+            if (child.delta == 0 && child.plies < proof) proof = child.plies; // Quickest win
+            if (child.plies > longest) longest = child.plies;                 // Longest defence
         }
+        result.delta = dfpnClamp3D(delta);
+        result.plies = (result.phi == 0) ? proof + 1 : (result.delta == 0) ? longest + 1 : 0;
+        if (result.phi >= thPhi || result.delta >= thDelta) break;
+        if (atomic_load_explicit(&solverStop3D, memory_order_relaxed)) break;
+
+        // The child may spend the parent's delta budget less the other children's
+        // share, and must not rise past the runner-up
+        uint32_t childThPhi = dfpnClamp3D((uint64_t)thDelta - result.delta + bestPhi);
+        uint32_t childThDelta = thPhi < secondDelta + 1 ? thPhi : dfpnClamp3D((uint64_t)secondDelta + 1);
+        playCell3D(position, cells[best], side);
+        dfpnSearch3D(position, childThPhi, childThDelta);
+        undoCell3D(position, cells[best]);
+    }
+    dfpnStore3D(key, result);
+    return result;
+}
+
+// Result of the child reached by playing `cell`, if the solve left it settled:
+// on the spot, or in the table
+static bool dfpnSettledChild3D(struct Position3D *position, int cell, int side, struct DfpnResult3D *child) {
+    uint64_t moves;
+    playCell3D(position, cell, side);
+    bool known = dfpnTerminal3D(position, child, &moves) || dfpnProbe3D(dfpnKey3D(position), child);
+    undoCell3D(position, cell);
+    return known && (child->phi == 0 || child->delta == 0);
+}
+
+// Answers both questions for the root, then picks its move: the quickest win,
+// a drawing move, or the longest defence. A question only counts as answered
+// once the root is proven or disproven; numbers that merely saturated leave
+// the result unknown.
+static void *runSolver3D(void *unused) {
+    (void)unused;
+    struct Position3D position = solverRoot3D;
+    int side = sideToMove3D(&position);
+    enum SolveResult3D outcome = SOLVE_UNKNOWN;
+    struct DfpnResult3D result = {0};
+
+    for (int question = 1; question <= 2 && outcome == SOLVE_UNKNOWN; question++) {
+        atomic_store(&solverQuestion3D, question);
+        dfpnAttacker3D = (question == 1) ? side : PLAYER + AI - side;
+        result = dfpnSearch3D(&position, DFPN_INFINITY, DFPN_INFINITY);
+        if (atomic_load(&solverStop3D)) break;
+        if (result.phi != 0 && result.delta != 0) break;
+        if (question == 1 && result.phi == 0) outcome = SOLVE_WIN;
+        else if (question == 2) outcome = (result.phi == 0) ? SOLVE_DRAW : SOLVE_LOSS;
+    }
+
+    int move = -1, plies = result.plies;
+    if (outcome != SOLVE_UNKNOWN) {
+        struct DfpnResult3D settled;
+        uint64_t moves;
+        if (dfpnTerminal3D(&position, &settled, &moves)) {
+            uint64_t wins = winningCells3D(&position, side); // Win at once, or lose whatever the move
+            move = __builtin_ctzll(wins ? wins : landingCells3D(&position)) % (ROWS * COLS);
+            moves = 0;
+        }
+        // The proof already settled the children it needed; only those whose
+        // entries were evicted are searched again. One winning or drawing reply
+        // is enough, but a loss compares every defence.
+        int bestPlies = 0;
+        uint64_t evicted = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (uint64_t left = pass ? evicted : moves; left; left &= left - 1) {
+                if (pass && ((move != -1 && outcome != SOLVE_LOSS) || atomic_load(&solverStop3D))) break;
+                int cell = __builtin_ctzll(left);
+                struct DfpnResult3D child;
+                if (pass) {
+                    playCell3D(&position, cell, side);
+                    child = dfpnSearch3D(&position, DFPN_INFINITY, DFPN_INFINITY);
+                    undoCell3D(&position, cell);
+                } else if (!dfpnSettledChild3D(&position, cell, side, &child)) {
+                    evicted |= 1ULL << cell;
+                    continue;
+                }
+                bool better;
+                if (outcome == SOLVE_LOSS) better = child.phi == 0 && (move == -1 || child.plies > bestPlies);
+                else better = child.delta == 0 && (move == -1 || child.plies < bestPlies);
+                if (better) {
+                    move = cell % (ROWS * COLS);
+                    bestPlies = child.plies;
+                }
+            }
+        }
+        if (move == -1) outcome = SOLVE_UNKNOWN; // Stopped while choosing
+    }
+
+    solverResult3D = outcome;
+    solverPlies3D = plies;
+    solverMove3D = move;
+    atomic_store(&solverRunning3D, false);
+    return NULL;
+}
+
+// Stops any solve in progress and waits for its thread
+void stopSolver3D() {
+    if (!solverStarted3D) return;
+    atomic_store(&solverStop3D, true);
+    pthread_join(solverThread3D, NULL);
+    atomic_store(&solverStop3D, false);
+    solverStarted3D = false;
+}
+
+// Table size for the next solve; drops the table and everything in it
+void setSolverMemory3D(size_t megabytes) {
+    stopSolver3D();
+    free(dfpnTable3D);
+    dfpnTable3D = NULL;
+    solverMemoryMb3D = megabytes ? megabytes : 1;
+}
+
+// Starts solving `position` on a background thread, replacing any solve in
+// progress; false if the table can't be allocated
+bool startSolver3D(const struct Position3D *position) {
+    stopSolver3D();
+    solverResult3D = SOLVE_UNKNOWN;
+    solverMove3D = -1;
+    if (!dfpnTable3D) {
+        dfpnBuckets3D = solverMemoryMb3D * 1024 * 1024 / (DFPN_BUCKET * sizeof(struct DfpnEntry3D));
+        dfpnTable3D = calloc(dfpnBuckets3D * DFPN_BUCKET, sizeof(struct DfpnEntry3D));
+        if (!dfpnTable3D) return false;
+        atomic_store(&dfpnEntries3D, 0);
+    }
+    solverRoot3D = *position;
+    atomic_store(&solverNodes3D, 0);
+    atomic_store(&solverQuestion3D, 1);
+    atomic_store(&solverRunning3D, true);
+    if (pthread_create(&solverThread3D, NULL, runSolver3D, NULL) != 0) {
+        atomic_store(&solverRunning3D, false);
+        return false;
+    }
+    solverStarted3D = true;
+    return true;
+}
+
+// State of the last solve started; the result and move are set once it stops running
+void solverProgress3D(struct SolverProgress3D *out) {
+    out->running = atomic_load(&solverRunning3D);
+    out->sideToMove = sideToMove3D(&solverRoot3D);
+    out->question = atomic_load(&solverQuestion3D);
+    out->result = out->running ? SOLVE_UNKNOWN : solverResult3D;
+    out->plies = out->running ? 0 : solverPlies3D;
+    out->move = out->running ? -1 : solverMove3D;
+    out->nodes = atomic_load_explicit(&solverNodes3D, memory_order_relaxed);
+    out->entries = atomic_load_explicit(&dfpnEntries3D, memory_order_relaxed);
+    out->capacity = dfpnBuckets3D * DFPN_BUCKET;
+}
+
+// One line on the last solve for the GUI, e.g. "Proven: AI wins within 7
+// stones". The count is the longest line of the proof found, not of perfect
+// play, so it is an upper bound.
+const char *solverStatus3D() {
+    struct SolverProgress3D progress;
+    solverProgress3D(&progress);
+    const char *side = (progress.sideToMove == AI) ? "AI" : "Player";
+    const char *other = (progress.sideToMove == AI) ? "Player" : "AI";
+    if (progress.running) {
+        return TextFormat("Solving (can %s win?): %lld nodes, table %d%% full",
+                          progress.question == 1 ? side : other, progress.nodes,
+                          progress.capacity ? (int)(100 * progress.entries / progress.capacity) : 0);
+    }
+    switch (progress.result) {
+        case SOLVE_WIN: return TextFormat("Proven: %s wins within %d stones", side, progress.plies);
+        case SOLVE_LOSS: return TextFormat("Proven: %s wins within %d stones", other, progress.plies);
+        case SOLVE_DRAW: return "Proven: draw";
+        default: return "Not solved";
     }
-    return -1; // Column is full
 }
 
 // ----------------------- RAYLIB VISUALIZATION & GAME LOOP -----------------------
@@ -359,6 +957,7 @@ void drawBoardRaylib() {
         DrawText("1. Easy", GetScreenWidth() / 2 - MeasureText("1. Easy", 30) / 2, GetScreenHeight() / 2 - 20, 30, DARKGREEN);
         DrawText("2. Medium", GetScreenWidth() / 2 - MeasureText("2. Medium", 30) / 2, GetScreenHeight() / 2 + 20, 30, ORANGE);
         DrawText("3. Hard", GetScreenWidth() / 2 - MeasureText("3. Hard", 30) / 2, GetScreenHeight() / 2 + 60, 30, MAROON);
+        DrawText("4. Perfect", GetScreenWidth() / 2 - MeasureText("4. Perfect", 30) / 2, GetScreenHeight() / 2 + 100, 30, DARKBLUE);
     } else {
         // Draw Game Board and UI (STATE_PLAYING or STATE_GAME_OVER)
         BeginMode3D(camera);
@@ -375,9 +974,10 @@ void drawBoardRaylib() {
         for (int h = 0; h < HEIGHT; h++) {
             for (int r = 0; r < ROWS; r++) {
                 for (int c = 0; c < COLS; c++) {
-                    if (board3D[h][r][c] != EMPTY) {
+                    int piece = pieceAt3D(h, r, c);
+                    if (piece != EMPTY) {
                         Vector3 pos = GetPiecePosition(h, r, c);
-                        Color color = (board3D[h][r][c] == PLAYER) ? RED : YELLOW;
+                        Color color = (piece == PLAYER) ? RED : YELLOW;
                         DrawSphere(pos, PIECE_RADIUS, color);
                     }
                     // Optional: Draw faint spheres for empty slots
@@ -444,11 +1044,13 @@ void drawBoardRaylib() {
             DrawText(turnText, 10, 40, 20, (currentPlayer == PLAYER) ? RED : ORANGE);
             // Optionally display current difficulty
             const char* diffText;
-            if (difficulty == DEPTH_EASY) diffText = "Easy";
+            if (perfectPlay) diffText = "Perfect";
+            else if (difficulty == DEPTH_EASY) diffText = "Easy";
             else if (difficulty == DEPTH_MEDIUM) diffText = "Medium";
             else diffText = "Hard";
             DrawText(TextFormat("Difficulty: %s", diffText), GetScreenWidth() - 150, 10, 20, DARKGRAY);
         }
+        if (perfectPlay) DrawText(solverStatus3D(), 10, GetScreenHeight() - 30, 20, DARKGRAY);
     }
 }
 
@@ -470,6 +1072,11 @@ void updateGameRaylib() {
         } else if (IsKeyPressed(KEY_THREE)) {
             difficulty = DEPTH_HARD;
             currentGameState = STATE_PLAYING;
+        } else if (IsKeyPressed(KEY_FOUR)) {
+            difficulty = DEPTH_HARD; // For the moves the solver hasn't proven in time
+            perfectPlay = true;
+            startSolver3D(&position3D);
+            currentGameState = STATE_PLAYING;
         }
     } else if (currentGameState == STATE_PLAYING) {
         // --- Existing Game Logic (with camera controls moved inside) ---
@@ -536,24 +1143,27 @@ void updateGameRaylib() {
                 if (r < 0) r = 0; if (r >= ROWS) r = ROWS - 1;
 
                 // Update preview state if the move is valid
-                if (isValidMove3D(r, c)) {
+                if (isValidMove3D(&position3D, r, c)) {
                     previewH = findLandingHeight(r, c);
                     previewR = r;
                     previewC = c;
 
                     // Check for actual click to make the move
                     if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-                        makeMove3D(r, c, PLAYER);
+                        makeMove3D(&position3D, r, c, PLAYER);
                         // Reset preview immediately after move
                         previewH = -1; previewR = -1; previewC = -1;
-                        if (winningMove3D(PLAYER)) {
+                        if (winningMove3D(&position3D, PLAYER)) {
+                            markWinningLine3D(PLAYER);
                             currentGameState = STATE_GAME_OVER;
                             winner = PLAYER;
-                        } else if (isFull3D()) {
+                        } else if (isFull3D(&position3D)) {
                             currentGameState = STATE_GAME_OVER;
                             winner = 3; // Draw
                         } else {
                             currentPlayer = AI;
+                            aiTurnStart = GetTime();
+                            if (perfectPlay) startSolver3D(&position3D);
                         }
                     }
                 } else {
@@ -567,22 +1177,33 @@ void updateGameRaylib() {
         }
         // AI's Turn Logic
         else if (currentPlayer == AI) {
-            int ai_r, ai_c;
-            getBestMove3D(&ai_r, &ai_c);
+            int ai_r = -1, ai_c = -1;
+            if (perfectPlay) {
+                struct SolverProgress3D progress;
+                solverProgress3D(&progress);
+                if (progress.running && GetTime() - aiTurnStart < SOLVER_WAIT_SECONDS) return; // Keep drawing while it works
+                if (progress.move != -1) {
+                    ai_r = progress.move / COLS;
+                    ai_c = progress.move % COLS;
+                }
+            }
+            if (ai_r == -1) getBestMove3D(&ai_r, &ai_c);
 
             if (ai_r != -1 && ai_c != -1) { // Check if a valid move was found
-                makeMove3D(ai_r, ai_c, AI);
+                makeMove3D(&position3D, ai_r, ai_c, AI);
                  printf("AI moved at r=%d, c=%d\n", ai_r, ai_c); // Debug print
-                if (winningMove3D(AI)) {
+                if (winningMove3D(&position3D, AI)) {
+                    markWinningLine3D(AI);
                     // gameOver = true; // Replaced by state change
                     currentGameState = STATE_GAME_OVER;
                     winner = AI;
-                } else if (isFull3D()) {
+                } else if (isFull3D(&position3D)) {
                     // gameOver = true; // Replaced by state change
                     currentGameState = STATE_GAME_OVER;
                     winner = 3; // Use 3 for Draw consistently
                 } else {
                     currentPlayer = PLAYER;
+                    if (perfectPlay) startSolver3D(&position3D);
                 }
             } else {
                 // Should not happen unless board is full and isFull3D() didn't catch it
@@ -597,7 +1218,9 @@ void updateGameRaylib() {
     } else { // STATE_GAME_OVER
         // Handle Restart Input
         if (IsKeyPressed(KEY_R)) {
-            memset(board3D, EMPTY, sizeof(board3D));
+            stopSolver3D();
+            perfectPlay = false;
+            position3D = (struct Position3D){0};
             currentPlayer = PLAYER;
             winner = EMPTY;
             // Reset winning line info
@@ -645,7 +1268,17 @@ void updateGameRaylib() {
 
 // ----------------------- MAIN (Modified for Raylib) -----------------------
 
-int main() {
+// `threeDConnectFour.exe [solver MB]`: the argument caps the perfect mode's solver table
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        int megabytes = atoi(argv[1]);
+        if (megabytes <= 0) {
+            printf("Usage: %s [solver table size in MB, default %d]\n", argv[0], SOLVER_MEMORY_MB);
+            return 1;
+        }
+        setSolverMemory3D((size_t)megabytes);
+    }
+
     // Initialization
     const int screenWidth = 800; // Adjusted size
     const int screenHeight = 600; // Adjusted size
@@ -659,8 +1292,9 @@ int main() {
     camera.fovy = 45.0f;                                // Camera field-of-view Y
     camera.projection = CAMERA_PERSPECTIVE;             // Camera mode type
 
-    // Initialize 3D board (memset is fine for 4x4x4)
-    memset(board3D, EMPTY, sizeof(board3D));
+    // Initialize 3D board
+    initLines3D();
+    position3D = (struct Position3D){0};
     currentPlayer = PLAYER; // Start with player
     gameOver = false;
     winner = EMPTY;
@@ -685,6 +1319,7 @@ int main() {
     }
 
     // De-Initialization
+    stopSolver3D();
     CloseWindow();                // Close window and OpenGL context
 
     return 0;
@@ -5,7 +5,10 @@
 #include <limits.h>
 #include <time.h>
 #include <ctype.h>
+#include "searchStats.h" // Opt-in node counters (-DSEARCH_STATS)
+#ifndef TWOD_CHESS_HEADLESS
 #include "include/raylib.h" // Add raylib header
+#endif // Headless builds (e.g. twoDChessSelfPlay.c) only need the engine
 
 #define BOARD_SIZE 8
 #define MAX_MOVES 256
@@ -80,12 +83,21 @@ struct Board {
     // TODO: Add history for threefold repetition
 };
 
+// Limits for one engine search. A limit of 0 means "unlimited" (max_depth must be set).
+struct SearchLimits {
+    int max_depth;   // Iterative deepening stops after this depth
+    long max_nodes;  // Abort once this many nodes have been searched
+    int max_time_ms; // Abort once this much wall-clock time has passed
+};
+
+#ifndef TWOD_CHESS_HEADLESS
 // --- Global Variables ---
 Texture2D pieceTextures[2][7]; // [Color: PLAYER_WHITE=0, PLAYER_BLACK=1][PieceType: EMPTY=0, PAWN=1..KING=6]
 enum GameState currentGameState = MENU_DIFFICULTY;
 int selectedDifficulty = 2; // Default Medium
 bool playerIsWhite = true; // Default White
 struct Move pendingPromotionMove; // To store move details during promotion selection
+#endif
 
 // --- Piece-Square Tables (White's perspective, mirrored for Black) ---
 // Values are somewhat arbitrary, based on common chess engine principles.
@@ -182,6 +194,8 @@ int evaluate_board(const struct Board *board); // Keep prototype
 bool is_game_over(struct Board *board, char *result_message, int buffer_size);
 int minimax(struct Board *board, int depth, int alpha, int beta, bool maximizing_player);
 void ai_make_move(struct Board *board, int difficulty);
+bool search_best_move(struct Board *board, const struct SearchLimits *limits, struct Move *best_move, int *best_eval);
+#ifndef TWOD_CHESS_HEADLESS
 bool LoadPieceTextures();
 void UnloadPieceTextures();
 // --- UI Drawing Functions ---
@@ -279,6 +293,7 @@ void DrawPieces(const struct Board *board, int screenWidth, int screenHeight) {
         }
     }
 }
+#endif // TWOD_CHESS_HEADLESS
 
 void display_piece_legend() {
     printf("\nPiece Legend:\n");
@@ -1007,7 +1022,46 @@ bool is_game_over(struct Board *board, char *result_message, int buffer_size) {
     return false;
 }
 
+// --- Search State ---
+// Per-thread so that self-play can run one independent search per thread.
+struct SearchState {
+    long nodes;
+    long max_nodes;
+    struct timespec deadline;
+    bool has_deadline;
+    bool aborted;
+};
+static _Thread_local struct SearchState search_state;
+
+#define ABORT_CHECK_INTERVAL 1024 // Nodes between clock checks
+
+static struct timespec time_now() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts;
+}
+
+// Counts a node and reports whether the current search has run out of budget
+static bool search_should_abort() {
+    if (search_state.aborted) return true;
+    search_state.nodes++;
+    if (search_state.max_nodes > 0 && search_state.nodes >= search_state.max_nodes) {
+        search_state.aborted = true;
+    } else if (search_state.has_deadline && (search_state.nodes % ABORT_CHECK_INTERVAL) == 0) {
+        struct timespec now = time_now();
+        if (now.tv_sec > search_state.deadline.tv_sec ||
+            (now.tv_sec == search_state.deadline.tv_sec && now.tv_nsec >= search_state.deadline.tv_nsec)) {
+            search_state.aborted = true;
+        }
+    }
+    return search_state.aborted;
+}
+
 int minimax(struct Board *board, int depth, int alpha, int beta, bool maximizing_player) {
+    // Result is discarded by the caller once the search is aborted
+    if (search_should_abort()) return 0;
+    STATS_INC(nodes);
+
     char msg[100];
     // Check game over state at the beginning of the evaluation
     if (is_game_over(board, msg, sizeof(msg))) {
@@ -1044,7 +1098,10 @@ int minimax(struct Board *board, int depth, int alpha, int beta, bool maximizing
             undo_move(board, &moves[i]);
             max_eval = (eval > max_eval) ? eval : max_eval;
             alpha = (alpha > max_eval) ? alpha : max_eval; // Update alpha
-            if (beta <= alpha) break; // Pruning
+            if (beta <= alpha) { // Pruning
+                STATS_CUTOFF(i);
+                break;
+            }
         }
         return max_eval;
     } else { // Black's turn (or AI is Black)
@@ -1055,31 +1112,39 @@ int minimax(struct Board *board, int depth, int alpha, int beta, bool maximizing
             undo_move(board, &moves[i]);
             min_eval = (eval < min_eval) ? eval : min_eval;
             beta = (beta < min_eval) ? beta : min_eval; // Update beta
-            if (beta <= alpha) break; // Pruning
+            if (beta <= alpha) { // Pruning
+                STATS_CUTOFF(i);
+                break;
+            }
         }
         return min_eval;
     }
 }
 
-void ai_make_move(struct Board *board, int difficulty) {
+// Searches every root move with a full window at increasing depths until the
+// limits are hit. Returns false only if there is no legal move.
+// An interrupted iteration still counts once its first move (the previous
+// best) has been searched completely.
+bool search_best_move(struct Board *board, const struct SearchLimits *limits, struct Move *best_move, int *best_eval) {
     struct Move moves[MAX_MOVES];
     int move_count = generate_legal_moves(board, moves); // Use legal moves
 
-    if (move_count == 0) return; // Game should already be over
-
-    int best_move_index = 0;
-    int best_eval = (board->current_player == PLAYER_WHITE) ? -INFINITY -1 : INFINITY + 1;
-
-    int depth;
-    switch (difficulty) {
-        case 1: depth = 2; break;
-        case 2: depth = 3; break;
-        case 3: depth = 4; break;
-        default: depth = 3; break;
+    if (move_count == 0) return false; // Game should already be over
+
+    search_state = (struct SearchState){0};
+    search_state.max_nodes = limits->max_nodes;
+    if (limits->max_time_ms > 0) {
+        search_state.deadline = time_now();
+        search_state.deadline.tv_sec += limits->max_time_ms / 1000;
+        search_state.deadline.tv_nsec += (limits->max_time_ms % 1000) * 1000000L;
+        if (search_state.deadline.tv_nsec >= 1000000000L) {
+            search_state.deadline.tv_sec++;
+            search_state.deadline.tv_nsec -= 1000000000L;
+        }
+        search_state.has_deadline = true;
     }
 
-    enum PlayerColor ai_color = board->current_player;
-    bool is_ai_white = (ai_color == PLAYER_WHITE);
+    bool is_ai_white = (board->current_player == PLAYER_WHITE);
 
     // --- Move Ordering for Root --- (Optional but good practice)
     // Score moves at the root as well to potentially break ties better
@@ -1089,39 +1154,69 @@ void ai_make_move(struct Board *board, int difficulty) {
     qsort(moves, move_count, sizeof(struct Move), compare_moves);
     // --- End Move Ordering for Root ---
 
-    for (int i = 0; i < move_count; i++) {
-        make_move(board, &moves[i]);
-        int eval = minimax(board, depth - 1, -INFINITY -1 , INFINITY + 1, !is_ai_white);
-        undo_move(board, &moves[i]);
+    *best_move = moves[0];
+    *best_eval = 0;
+    STATS_BEGIN_SEARCH();
 
-        // Store the minimax eval, overwriting the move ordering score
-        moves[i].score = eval; 
+    int max_depth = (limits->max_depth > 0) ? limits->max_depth : 1;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        int best_move_index = -1;
+        int iteration_best = is_ai_white ? -INFINITY - 1 : INFINITY + 1;
+        STATS_BEGIN_ITERATION(depth);
+        STATS_INC(nodes); // Root
 
-        if (is_ai_white) { // White AI wants to maximize the score
-            if (eval > best_eval) {
-                best_eval = eval;
-                best_move_index = i;
-            }
-        } else { // Black AI wants to minimize the score (from White's perspective)
-            if (eval < best_eval) {
-                best_eval = eval;
+        for (int i = 0; i < move_count; i++) {
+            make_move(board, &moves[i]);
+            int eval = minimax(board, depth - 1, -INFINITY - 1, INFINITY + 1, !is_ai_white);
+            undo_move(board, &moves[i]);
+            if (search_state.aborted) break;
+
+            // White AI wants to maximize the score, Black AI to minimize it (from White's perspective)
+            if (best_move_index == -1 || (is_ai_white ? eval > iteration_best : eval < iteration_best)) {
+                iteration_best = eval;
                 best_move_index = i;
             }
         }
-        // Add randomness for moves with the same best_eval?
-        // if (eval == best_eval && (rand() % 3 == 0)) { // Example: 1/3 chance to switch to equally good move
-        //     best_move_index = i;
-        // }
+
+        if (best_move_index != -1) {
+            *best_move = moves[best_move_index];
+            *best_eval = iteration_best;
+            // Search the best move first in the next iteration
+            struct Move best = moves[best_move_index];
+            memmove(&moves[1], &moves[0], best_move_index * sizeof(struct Move));
+            moves[0] = best;
+        }
+        STATS_END_ITERATION();
+        if (search_state.aborted) break;
     }
+    STATS_DUMP("2d-chess");
+    return true;
+}
+
+void ai_make_move(struct Board *board, int difficulty) {
+    struct SearchLimits limits = {0};
+    switch (difficulty) {
+        case 1: limits.max_depth = 2; break;
+        case 2: limits.max_depth = 3; break;
+        case 3: limits.max_depth = 4; break;
+        default: limits.max_depth = 3; break;
+    }
+
+    struct Move best_move;
+    int best_eval;
+    if (!search_best_move(board, &limits, &best_move, &best_eval)) return; // Game should already be over
+
+    bool is_ai_white = (board->current_player == PLAYER_WHITE);
 
     // Make the best move found
-    make_move(board, &moves[best_move_index]);
+    make_move(board, &best_move);
     printf("AI (%s) moves from %c%d to %c%d (Eval: %d)\n",
            is_ai_white ? "White" : "Black",
-           'a' + moves[best_move_index].from_col, 8 - moves[best_move_index].from_row,
-           'a' + moves[best_move_index].to_col, 8 - moves[best_move_index].to_row, best_eval);
+           'a' + best_move.from_col, 8 - best_move.from_row,
+           'a' + best_move.to_col, 8 - best_move.to_row, best_eval);
 }
 
+#ifndef TWOD_CHESS_HEADLESS
 // --- Main Game Loop (Updated with Restart) ---
 
 void play_game() {
@@ -1447,4 +1542,5 @@ int main() {
     play_game(); // Call play_game without arguments
 
     return 0;
-}
\ No newline at end of file
+}
+#endif // TWOD_CHESS_HEADLESS
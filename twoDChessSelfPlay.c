@@ -0,0 +1,479 @@
+// Headless self-play tournament runner for the twoDChess.c engine.
+//
+// Plays engine-vs-engine games on all cores (one game per thread, each with
+// its own struct Board), starting from an opening book plus a few random plies
+// with colors swapped per opening, and reports the Elo difference of engine A
+// over engine B with 95% error bars. An optional SPRT stops the match as soon as the result is
+// statistically clear.
+//
+// Build: gcc -O2 -o twoDChessSelfPlay twoDChessSelfPlay.c -lpthread -lm
+//
+// Example (does a 2x node budget gain strength?):
+//   twoDChessSelfPlay -games 2000 -depth 64 64 -nodes 40000 20000 -sprt 0 10
+
+#include <math.h>
+#undef INFINITY // The engine uses its own integer INFINITY
+#define TWOD_CHESS_HEADLESS
+#include "twoDChess.c"
+
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define MAX_OPENINGS 1024
+#define MAX_OPENING_PLIES 32
+#define MAX_GAME_PLIES 1024
+#define WORKER_STACK_SIZE (32 * 1024 * 1024) // Deep searches keep a move list per ply on the stack
+
+enum GameResult {
+    RESULT_WHITE_WINS,
+    RESULT_BLACK_WINS,
+    RESULT_DRAW
+};
+
+struct Opening {
+    char moves[MAX_OPENING_PLIES][6]; // Coordinate notation, e.g. "e2e4" or "e7e8q"
+    int ply_count;
+};
+
+// Built-in book used when no -book file is given
+static const char *default_book[] = {
+    "e2e4 e7e5 g1f3 b8c6 f1b5",
+    "e2e4 e7e5 g1f3 b8c6 f1c4",
+    "e2e4 c7c5 g1f3 d7d6",
+    "e2e4 c7c5 b1c3 b8c6",
+    "e2e4 e7e6 d2d4 d7d5",
+    "e2e4 c7c6 d2d4 d7d5",
+    "e2e4 d7d5 e4d5 d8d5",
+    "e2e4 g8f6 e4e5 f6d5",
+    "e2e4 d7d6 d2d4 g8f6",
+    "d2d4 d7d5 c2c4 e7e6",
+    "d2d4 d7d5 c2c4 c7c6",
+    "d2d4 d7d5 c2c4 d5c4",
+    "d2d4 g8f6 c2c4 e7e6 b1c3 f8b4",
+    "d2d4 g8f6 c2c4 g7g6 b1c3 f8g7",
+    "d2d4 g8f6 c2c4 c7c5 d4d5",
+    "d2d4 f7f5 g2g3 g8f6",
+    "c2c4 e7e5 b1c3 g8f6",
+    "c2c4 c7c5 g1f3 b8c6",
+    "g1f3 d7d5 g2g3 g8f6",
+    "g1f3 g8f6 c2c4 g7g6",
+    "e2e4 e7e5 f2f4 e5f4",
+    "e2e4 e7e5 b1c3 g8f6",
+    "b2b3 e7e5 c1b2 b8c6",
+    "f2f4 d7d5 g1f3 g8f6",
+};
+
+// --- Match Configuration and Shared State ---
+
+struct MatchConfig {
+    struct SearchLimits engine[2]; // [0] = engine A (under test), [1] = engine B (baseline)
+    int games;
+    int threads;
+    int max_plies;
+    int random_plies;       // Random legal moves played after the book line
+    unsigned int seed;
+    bool sprt_enabled;
+    double sprt_elo0;
+    double sprt_elo1;
+    double sprt_alpha;
+    double sprt_beta;
+};
+
+struct MatchState {
+    pthread_mutex_t lock;
+    int next_game;
+    int games_done;
+    int wins, draws, losses; // From engine A's point of view
+    bool stop;
+    const char *stop_reason;
+};
+
+static struct MatchConfig config;
+static struct MatchState match;
+static struct Opening openings[MAX_OPENINGS];
+static int opening_count = 0;
+
+// --- Opening Book ---
+
+static bool parse_opening_line(const char *line, struct Opening *opening) {
+    opening->ply_count = 0;
+    const char *p = line;
+    while (*p) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (!*p || *p == '#') break;
+        int len = 0;
+        while (p[len] && !isspace((unsigned char)p[len])) len++;
+        if (len < 4 || len > 5 || opening->ply_count >= MAX_OPENING_PLIES) return false;
+        memcpy(opening->moves[opening->ply_count], p, len);
+        opening->moves[opening->ply_count][len] = '\0';
+        opening->ply_count++;
+        p += len;
+    }
+    return opening->ply_count > 0;
+}
+
+static bool load_book(const char *filename) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        fprintf(stderr, "Error: Could not open book '%s'\n", filename);
+        return false;
+    }
+    char line[512];
+    while (opening_count < MAX_OPENINGS && fgets(line, sizeof(line), f)) {
+        if (parse_opening_line(line, &openings[opening_count])) opening_count++;
+    }
+    fclose(f);
+    return opening_count > 0;
+}
+
+static void load_default_book() {
+    int n = sizeof(default_book) / sizeof(default_book[0]);
+    for (int i = 0; i < n; i++) {
+        if (parse_opening_line(default_book[i], &openings[opening_count])) opening_count++;
+    }
+}
+
+// Finds the legal move matching coordinate notation ("e2e4", "a7a8q")
+static bool find_book_move(struct Board *board, const char *text, struct Move *move) {
+    int from_col = text[0] - 'a', from_row = 8 - (text[1] - '0');
+    int to_col = text[2] - 'a', to_row = 8 - (text[3] - '0');
+    enum Piece promotion = EMPTY;
+    switch (text[4]) {
+        case 'q': promotion = QUEEN; break;
+        case 'r': promotion = ROOK; break;
+        case 'b': promotion = BISHOP; break;
+        case 'n': promotion = KNIGHT; break;
+        default: break;
+    }
+
+    struct Move legal_moves[MAX_MOVES];
+    int legal_move_count = generate_legal_moves(board, legal_moves);
+    for (int i = 0; i < legal_move_count; i++) {
+        if (legal_moves[i].from_row == from_row && legal_moves[i].from_col == from_col &&
+            legal_moves[i].to_row == to_row && legal_moves[i].to_col == to_col &&
+            (legal_moves[i].promotion == promotion || (promotion == EMPTY && legal_moves[i].promotion == QUEEN))) {
+            *move = legal_moves[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// --- Game Play ---
+
+// The engine is deterministic, so without these random plies every pass over
+// the book would replay the same games
+static unsigned int next_random(unsigned int *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static bool same_position(const struct Board *a, const struct Board *b) {
+    return memcmp(a->squares, b->squares, sizeof(a->squares)) == 0 &&
+           a->current_player == b->current_player &&
+           a->white_castle_kingside == b->white_castle_kingside &&
+           a->white_castle_queenside == b->white_castle_queenside &&
+           a->black_castle_kingside == b->black_castle_kingside &&
+           a->black_castle_queenside == b->black_castle_queenside &&
+           a->en_passant_row == b->en_passant_row &&
+           a->en_passant_col == b->en_passant_col;
+}
+
+// Only positions since the last irreversible move can repeat
+static bool is_threefold_repetition(const struct Board history[], int ply) {
+    int repetitions = 1;
+    int first = ply - history[ply].halfmove_clock;
+    if (first < 0) first = 0;
+    for (int i = ply - 2; i >= first; i -= 2) {
+        if (same_position(&history[i], &history[ply]) && ++repetitions >= 3) return true;
+    }
+    return false;
+}
+
+// Both games of a pair get the same random plies, from the pair's own seed
+static enum GameResult play_one_game(const struct Opening *opening, int white_engine, int pair) {
+    // Heap-allocated: the history is too large for a worker thread's stack
+    struct Board *history = malloc(sizeof(struct Board) * (MAX_GAME_PLIES + 1));
+    if (!history) {
+        fprintf(stderr, "Error: Out of memory for a game's history\n");
+        exit(1);
+    }
+    struct Board board;
+    init_board(&board);
+    int ply = 0;
+    history[0] = board;
+
+    for (int i = 0; i < opening->ply_count; i++) {
+        struct Move move;
+        if (!find_book_move(&board, opening->moves[i], &move)) {
+            fprintf(stderr, "Warning: Illegal book move '%s', opening truncated\n", opening->moves[i]);
+            break;
+        }
+        make_move(&board, &move);
+        history[++ply] = board;
+    }
+
+    unsigned int random_state = (config.seed ^ (unsigned int)pair * 2654435761u) | 1;
+    for (int i = 0; i < config.random_plies; i++) {
+        struct Move legal_moves[MAX_MOVES];
+        int legal_move_count = generate_legal_moves(&board, legal_moves);
+        if (legal_move_count == 0) break;
+        make_move(&board, &legal_moves[next_random(&random_state) % legal_move_count]);
+        history[++ply] = board;
+    }
+
+    enum GameResult result = RESULT_DRAW;
+    char message[100];
+    while (true) {
+        if (is_game_over(&board, message, sizeof(message))) {
+            if (strstr(message, "Checkmate")) {
+                result = (board.current_player == PLAYER_WHITE) ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+            } else {
+                result = RESULT_DRAW;
+            }
+            break;
+        }
+        if (is_threefold_repetition(history, ply) || ply >= config.max_plies) {
+            result = RESULT_DRAW; // Repetition, or adjudicated as a draw
+            break;
+        }
+
+        int side = (board.current_player == PLAYER_WHITE) ? white_engine : 1 - white_engine;
+        struct Move move;
+        int eval;
+        if (!search_best_move(&board, &config.engine[side], &move, &eval)) break;
+        make_move(&board, &move);
+        history[++ply] = board;
+    }
+
+    free(history);
+    return result;
+}
+
+// --- Statistics ---
+
+static double expected_score(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+// Scores of 0% and 100% are clamped so that a clean sweep still prints a number
+static double score_to_elo(double score) {
+    if (score < 0.001) score = 0.001;
+    if (score > 0.999) score = 0.999;
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+// Elo of A over B with a 95% confidence interval
+static void compute_elo(int wins, int draws, int losses, double *elo, double *error) {
+    int n = wins + draws + losses;
+    if (n == 0) {
+        *elo = 0.0;
+        *error = 0.0;
+        return;
+    }
+    double score = (wins + 0.5 * draws) / n;
+    double variance = (wins * pow(1.0 - score, 2) + draws * pow(0.5 - score, 2) + losses * pow(score, 2)) / n;
+    double margin = 1.96 * sqrt(variance / n);
+    *elo = score_to_elo(score);
+    double low = score_to_elo(score - margin);
+    double high = score_to_elo(score + margin);
+    *error = (high - low) / 2.0;
+}
+
+// Log-likelihood ratio of H1 (elo1) against H0 (elo0), normal approximation
+// of the trinomial game-outcome model.
+// Half a pseudo-game per outcome keeps the variance sane over the first games.
+static double sprt_llr(int wins, int draws, int losses, double elo0, double elo1) {
+    if (wins + draws + losses == 0) return 0.0;
+    double w = wins + 0.5, d = draws + 0.5, l = losses + 0.5;
+    double n = w + d + l;
+    double score = (w + 0.5 * d) / n;
+    double variance = (w * pow(1.0 - score, 2) + d * pow(0.5 - score, 2) + l * pow(score, 2)) / n;
+    if (variance <= 0.0) return 0.0;
+    double s0 = expected_score(elo0);
+    double s1 = expected_score(elo1);
+    return (s1 - s0) * (2.0 * score - s0 - s1) / (2.0 * variance / n);
+}
+
+static void print_status(bool final) {
+    double elo, error;
+    compute_elo(match.wins, match.draws, match.losses, &elo, &error);
+    int n = match.wins + match.draws + match.losses;
+    printf("%s %d games: +%d =%d -%d  Elo %+.1f +/- %.1f",
+           final ? "Final:" : "After", n, match.wins, match.draws, match.losses, elo, error);
+    if (config.sprt_enabled) {
+        double llr = sprt_llr(match.wins, match.draws, match.losses, config.sprt_elo0, config.sprt_elo1);
+        double lower = log(config.sprt_beta / (1.0 - config.sprt_alpha));
+        double upper = log((1.0 - config.sprt_beta) / config.sprt_alpha);
+        printf("  LLR %.2f [%.2f, %.2f]", llr, lower, upper);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+// --- Worker Threads ---
+
+// Games are played in pairs: same opening, colors swapped
+static void *worker_main(void *arg) {
+    (void)arg;
+    while (true) {
+        pthread_mutex_lock(&match.lock);
+        if (match.stop || match.next_game >= config.games) {
+            pthread_mutex_unlock(&match.lock);
+            break;
+        }
+        int game = match.next_game++;
+        pthread_mutex_unlock(&match.lock);
+
+        const struct Opening *opening = &openings[(game / 2) % opening_count];
+        int white_engine = game % 2; // Engine A plays White in even games
+        enum GameResult result = play_one_game(opening, white_engine, game / 2);
+
+        pthread_mutex_lock(&match.lock);
+        if (result == RESULT_DRAW) {
+            match.draws++;
+        } else if ((result == RESULT_WHITE_WINS) == (white_engine == 0)) {
+            match.wins++;
+        } else {
+            match.losses++;
+        }
+        match.games_done++;
+
+        if (match.games_done % 20 == 0) print_status(false);
+        if (config.sprt_enabled && !match.stop) {
+            double llr = sprt_llr(match.wins, match.draws, match.losses, config.sprt_elo0, config.sprt_elo1);
+            if (llr >= log((1.0 - config.sprt_beta) / config.sprt_alpha)) {
+                match.stop = true;
+                match.stop_reason = "SPRT: H1 accepted (A is stronger)";
+            } else if (llr <= log(config.sprt_beta / (1.0 - config.sprt_alpha))) {
+                match.stop = true;
+                match.stop_reason = "SPRT: H0 accepted (A is not stronger)";
+            }
+        }
+        pthread_mutex_unlock(&match.lock);
+    }
+    return NULL;
+}
+
+static int count_cores() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int)n : 1;
+#endif
+}
+
+// --- Command Line ---
+
+static void print_usage(const char *program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  -games N          Number of games, played in color-swapped pairs (default 1000)\n");
+    printf("  -threads N        Worker threads, one game each (default: all cores)\n");
+    printf("  -book FILE        Openings, one per line in coordinate notation (e.g. e2e4 e7e5 g1f3)\n");
+    printf("  -depth A B        Maximum search depth for engine A and B (default 4 3)\n");
+    printf("  -nodes A B        Node limit per move, 0 = none (default 0 0)\n");
+    printf("  -time A B         Time limit per move in ms, 0 = none (default 0 0)\n");
+    printf("  -random N         Random plies after each book line, 0 = none (default 2)\n");
+    printf("  -seed N           Seed for the random plies (default 1)\n");
+    printf("  -maxplies N       Adjudicate a draw after N plies (default 400)\n");
+    printf("  -sprt ELO0 ELO1   Stop early with an SPRT on H0: elo=ELO0 vs H1: elo=ELO1\n");
+    printf("  -alpha A -beta B  SPRT error rates (default 0.05 0.05)\n");
+}
+
+static bool parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has1 = i + 1 < argc, has2 = i + 2 < argc;
+        if (strcmp(arg, "-games") == 0 && has1) config.games = atoi(argv[++i]);
+        else if (strcmp(arg, "-threads") == 0 && has1) config.threads = atoi(argv[++i]);
+        else if (strcmp(arg, "-book") == 0 && has1) { if (!load_book(argv[++i])) return false; }
+        else if (strcmp(arg, "-maxplies") == 0 && has1) config.max_plies = atoi(argv[++i]);
+        else if (strcmp(arg, "-random") == 0 && has1) config.random_plies = atoi(argv[++i]);
+        else if (strcmp(arg, "-seed") == 0 && has1) config.seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if (strcmp(arg, "-alpha") == 0 && has1) config.sprt_alpha = atof(argv[++i]);
+        else if (strcmp(arg, "-beta") == 0 && has1) config.sprt_beta = atof(argv[++i]);
+        else if (strcmp(arg, "-depth") == 0 && has2) {
+            config.engine[0].max_depth = atoi(argv[++i]);
+            config.engine[1].max_depth = atoi(argv[++i]);
+        } else if (strcmp(arg, "-nodes") == 0 && has2) {
+            config.engine[0].max_nodes = atol(argv[++i]);
+            config.engine[1].max_nodes = atol(argv[++i]);
+        } else if (strcmp(arg, "-time") == 0 && has2) {
+            config.engine[0].max_time_ms = atoi(argv[++i]);
+            config.engine[1].max_time_ms = atoi(argv[++i]);
+        } else if (strcmp(arg, "-sprt") == 0 && has2) {
+            config.sprt_enabled = true;
+            config.sprt_elo0 = atof(argv[++i]);
+            config.sprt_elo1 = atof(argv[++i]);
+        } else {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    config.engine[0] = (struct SearchLimits){ .max_depth = 4 };
+    config.engine[1] = (struct SearchLimits){ .max_depth = 3 };
+    config.games = 1000;
+    config.threads = count_cores();
+    config.max_plies = 400;
+    config.random_plies = 2;
+    config.seed = 1;
+    config.sprt_alpha = 0.05;
+    config.sprt_beta = 0.05;
+
+    if (!parse_args(argc, argv)) return 1;
+    if (opening_count == 0) load_default_book();
+    if (config.threads < 1) config.threads = 1;
+    if (config.max_plies > MAX_GAME_PLIES) config.max_plies = MAX_GAME_PLIES;
+    if (config.random_plies < 0) config.random_plies = 0;
+    if (config.random_plies > MAX_GAME_PLIES - MAX_OPENING_PLIES) config.random_plies = MAX_GAME_PLIES - MAX_OPENING_PLIES;
+
+    printf("Self-play: %d games, %d threads, %d openings, %d random plies\n",
+           config.games, config.threads, opening_count, config.random_plies);
+    for (int e = 0; e < 2; e++) {
+        printf("  Engine %c: depth %d, nodes %ld, time %d ms\n", 'A' + e,
+               config.engine[e].max_depth, config.engine[e].max_nodes, config.engine[e].max_time_ms);
+    }
+    if (config.random_plies == 0 && config.games > 2 * opening_count) {
+        printf("Warning: more games than 2 x openings and no random plies; the same games repeat,\n"
+               "         and the error bars and SPRT treat the repeats as independent\n");
+    }
+
+    pthread_mutex_init(&match.lock, NULL);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, WORKER_STACK_SIZE);
+    pthread_t *workers = malloc(sizeof(pthread_t) * config.threads);
+    if (!workers) {
+        fprintf(stderr, "Error: Out of memory for %d worker threads\n", config.threads);
+        return 1;
+    }
+    for (int t = 0; t < config.threads; t++) {
+        if (pthread_create(&workers[t], &attr, worker_main, NULL) != 0) {
+            fprintf(stderr, "Error: Could not start worker thread %d\n", t + 1);
+            exit(1);
+        }
+    }
+    pthread_attr_destroy(&attr);
+    for (int t = 0; t < config.threads; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+    pthread_mutex_destroy(&match.lock);
+
+    print_status(true);
+    if (match.stop_reason) printf("%s\n", match.stop_reason);
+    return 0;
+}
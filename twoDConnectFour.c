@@ -2,12 +2,15 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <string.h>
+#include <time.h>
 #include "include/raylib.h" // Include Raylib
+#include "connectFour.h" // Bitboard position
 
 // Define constants
-#define ROWS 6
-#define COLS 7
+#define ROWS C4_ROWS
+#define COLS C4_COLS
 #define PLAYER 1
 #define AI 2
 #define EMPTY 0
@@ -21,11 +24,38 @@
 #define BOARD_OFFSET_X 0
 #define BOARD_OFFSET_Y 100 // Offset board down to make space for messages
 
+// The AI deepens its search until its think time for the move runs out
+#define THINK_TIME_EASY_MS 50
+#define THINK_TIME_MEDIUM_MS 500
+#define THINK_TIME_HARD_MS 2000
+#define DEADLINE_CHECK_NODES 1024 // Nodes between clock reads
+
+// Perfect play: the solver gets this long per move before falling back to the timed search
+#define THINK_TIME_PERFECT -1
+#define SOLVER_TIME_MS 5000
+#define SOLVER_FALLBACK_TIME_MS 1000
+
+// Depth-limited search scores, from the AI's side. Wins outweigh any sum of the heuristic terms.
+#define WIN_SCORE 100000
+#define EVAL_OPEN_TWO 2      // Line of four with two of our stones and two empty cells
+#define EVAL_OPEN_THREE 8    // Three of our stones and one empty cell
+#define EVAL_THREAT 10       // Empty cell that would complete four, once per cell
+#define EVAL_GOOD_THREAT 30  // The same on a row that zugzwang favours: odd rows for the first player, even for the second
+#define EVAL_CENTER 3        // Stone in the center column
+
 // Global variable for difficulty (could be made local)
-int difficulty = 4; // Default difficulty
+int thinkTimeMs = THINK_TIME_MEDIUM_MS; // Time per AI move, THINK_TIME_PERFECT for the solver
+char solverNote[64]; // Solver verdict shown under the message in perfect mode
+
+// Search clock: minimax2D gives up once past the deadline. The root moves are
+// searched on several threads (see runParallel); each counts its own nodes.
+struct timespec searchDeadline;
+atomic_bool searchAborted;
+_Thread_local long long searchNodes;
 
-// Define the 2D board
-int board[ROWS][COLS];
+// Define the 2D board. The player always moves first, so the AI's stones are
+// the second player's; see connectFour.h for the bit layout.
+struct Position2D position;
 
 // Game state enum
 typedef enum {
@@ -47,82 +77,97 @@ void drawBoardRaylib(const char* message, GameState currentState); // Updated si
 void drawDifficultySelection(); // New drawing function for selection screen
 void resetGame(); // Added forward declaration
 int getBestMove2D();
-int minimax2D(int depth, int alpha, int beta, bool maximizing);
-int evaluateBoard2D();
+int minimax2D(struct Position2D position, int depth, int alpha, int beta, bool maximizing);
+int evaluateBoard2D(const struct Position2D *position);
 bool winningMove2D(int piece);
-void undoMove2D(int col);
-int makeMove2D(int col, int piece);
+void makeMove2D(int col);
+int pieceAt2D(int row, int col);
 bool isValidMove2D(int col);
 
 
 // ----------------------- 2D CONNECT 4 FUNCTIONS -----------------------
 
 bool isValidMove2D(int col) {
-    return col >= 0 && col < COLS && board[0][col] == EMPTY;
+    return col >= 0 && col < COLS && canPlay2D(&position, col);
 }
 
-int makeMove2D(int col, int piece) {
-    for (int r = ROWS - 1; r >= 0; r--) {
-        if (board[r][col] == EMPTY) {
-            board[r][col] = piece;
-            return r;
-        }
-    }
-    return -1;
+// Plays for whoever is to move: PLAYER after an even number of moves, AI after an odd one
+void makeMove2D(int col) {
+    play2D(&position, col);
 }
 
-void undoMove2D(int col) {
-    for (int r = 0; r < ROWS; r++) {
-        if (board[r][col] != EMPTY) {
-            board[r][col] = EMPTY;
-            break;
-        }
+bool winningMove2D(int piece) {
+    return alignment2D(stonesOf2D(&position, piece == PLAYER));
+}
+
+// PLAYER, AI or EMPTY; row 0 is the top row as drawn
+int pieceAt2D(int row, int col) {
+    uint64_t cell = cellMask2D(ROWS - 1 - row, col);
+    if ((position.mask & cell) == 0) return EMPTY;
+    return (stonesOf2D(&position, true) & cell) ? PLAYER : AI;
+}
+
+// Open twos and threes, threats and center stones for one side. Lines of four are
+// scored a direction at a time: bit b of `windowN` is set when the line starting
+// at b holds N of `stones` and nothing of the opponent's.
+static int sideScore2D(uint64_t stones, uint64_t empty, bool firstPlayer) {
+    static const int shifts[4] = {C4_COLUMN_BITS, 1, C4_COLUMN_BITS - 1, C4_COLUMN_BITS + 1};
+    uint64_t open = stones | empty; // Off-board and spare bits are never open, so no line wraps
+    int score = 0;
+    for (int i = 0; i < 4; i++) {
+        int s = shifts[i];
+        uint64_t a = stones, b = stones >> s, c = stones >> 2 * s, d = stones >> 3 * s;
+        uint64_t clear = open & (open >> s) & (open >> 2 * s) & (open >> 3 * s);
+        uint64_t three = clear & ((a & b & c & ~d) | (a & b & ~c & d) | (a & ~b & c & d) | (~a & b & c & d));
+        uint64_t atLeastTwo = (a & b) | (a & c) | (a & d) | (b & c) | (b & d) | (c & d);
+        uint64_t two = clear & atLeastTwo & ~three & ~(a & b & c & d);
+        score += EVAL_OPEN_TWO * __builtin_popcountll(two) + EVAL_OPEN_THREE * __builtin_popcountll(three);
     }
+
+    // Rows counted from 1 at the bottom: bit rows 0, 2, 4 are the odd rows
+    uint64_t oddRows = bottomRow2D() * 0x15;
+    uint64_t threats = winningCells2D(stones, ~empty & boardMask2D());
+    uint64_t goodThreats = threats & (firstPlayer ? oddRows : ~oddRows);
+    score += EVAL_GOOD_THREAT * __builtin_popcountll(goodThreats) + EVAL_THREAT * __builtin_popcountll(threats & ~goodThreats);
+    return score + EVAL_CENTER * __builtin_popcountll(stones & columnMask2D(COLS / 2));
 }
 
-bool winningMove2D(int piece) {
-    // Horizontal
-    for (int r = 0; r < ROWS; r++)
-        for (int c = 0; c < COLS - 3; c++)
-            if (board[r][c] == piece && board[r][c+1] == piece && board[r][c+2] == piece && board[r][c+3] == piece)
-                return true;
-    // Vertical
-    for (int c = 0; c < COLS; c++)
-        for (int r = 0; r < ROWS - 3; r++)
-            if (board[r][c] == piece && board[r+1][c] == piece && board[r+2][c] == piece && board[r+3][c] == piece)
-                return true;
-    // Positive Diagonal
-    for (int r = 0; r < ROWS - 3; r++)
-        for (int c = 0; c < COLS - 3; c++)
-            if (board[r][c] == piece && board[r+1][c+1] == piece && board[r+2][c+2] == piece && board[r+3][c+3] == piece)
-                return true;
-    // Negative Diagonal
-    for (int r = 3; r < ROWS; r++)
-        for (int c = 0; c < COLS - 3; c++)
-            if (board[r][c] == piece && board[r-1][c+1] == piece && board[r-2][c+2] == piece && board[r-3][c+3] == piece)
-                return true;
-    return false;
+// Heuristic for the depth limit; minimax2D has already ruled out a finished game
+int evaluateBoard2D(const struct Position2D *position) {
+    uint64_t empty = boardMask2D() & ~position->mask;
+    return sideScore2D(stonesOf2D(position, false), empty, false) - sideScore2D(stonesOf2D(position, true), empty, true);
 }
 
-int evaluateBoard2D() {
-    if (winningMove2D(AI)) return 100;
-    if (winningMove2D(PLAYER)) return -100;
-    return 0;
+static bool pastDeadline2D() {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return now.tv_sec > searchDeadline.tv_sec ||
+           (now.tv_sec == searchDeadline.tv_sec && now.tv_nsec >= searchDeadline.tv_nsec);
 }
 
-int minimax2D(int depth, int alpha, int beta, bool maximizing) {
-    if (winningMove2D(PLAYER)) return -100 - depth;
-    if (winningMove2D(AI)) return 100 + depth;
-    if (isFull2D()) return 0;
-    if (depth == 0) return evaluateBoard2D();
+// Columns are tried center first. The position is a copy, so each thread
+// searches its own. Returns 0 once the deadline has passed; the caller must
+// then discard the result.
+int minimax2D(struct Position2D position, int depth, int alpha, int beta, bool maximizing) {
+    if ((++searchNodes % DEADLINE_CHECK_NODES) == 0 && pastDeadline2D()) {
+        atomic_store_explicit(&searchAborted, true, memory_order_relaxed);
+    }
+    if (atomic_load_explicit(&searchAborted, memory_order_relaxed)) return 0;
+
+    // Only the side that just moved can have completed four: the player before
+    // a maximizing node (the player moves first), the AI before a minimizing one
+    if (alignment2D(stonesOf2D(&position, maximizing))) return maximizing ? -WIN_SCORE - depth : WIN_SCORE + depth;
+    if (position.moves == C4_CELLS) return 0;
+    if (depth == 0) return evaluateBoard2D(&position);
 
     if (maximizing) {
         int maxEval = INT_MIN;
-        for (int c = 0; c < COLS; c++) {
-            if (isValidMove2D(c)) {
-                makeMove2D(c, AI);
-                int eval = minimax2D(depth - 1, alpha, beta, false);
-                undoMove2D(c);
+        for (int i = 0; i < COLS; i++) {
+            int c = centerOrder2D[i];
+            if (canPlay2D(&position, c)) {
+                struct Position2D child = position;
+                play2D(&child, c);
+                int eval = minimax2D(child, depth - 1, alpha, beta, false);
                 maxEval = eval > maxEval ? eval : maxEval;
                 alpha = alpha > eval ? alpha : eval;
                 if (beta <= alpha)
@@ -132,11 +177,12 @@ int minimax2D(int depth, int alpha, int beta, bool maximizing) {
         return maxEval;
     } else {
         int minEval = INT_MAX;
-        for (int c = 0; c < COLS; c++) {
-            if (isValidMove2D(c)) {
-                makeMove2D(c, PLAYER);
-                int eval = minimax2D(depth - 1, alpha, beta, true);
-                undoMove2D(c);
+        for (int i = 0; i < COLS; i++) {
+            int c = centerOrder2D[i];
+            if (canPlay2D(&position, c)) {
+                struct Position2D child = position;
+                play2D(&child, c);
+                int eval = minimax2D(child, depth - 1, alpha, beta, true);
                 minEval = eval < minEval ? eval : minEval;
                 beta = beta < eval ? beta : eval;
                 if (beta <= alpha)
@@ -147,61 +193,98 @@ int minimax2D(int depth, int alpha, int beta, bool maximizing) {
     }
 }
 
-int getBestMove2D() {
-    int bestScore = INT_MIN;
-    int bestCol = -1;
-
-    // Prioritize center column slightly if available initially (simple heuristic)
-    if (isValidMove2D(COLS / 2)) {
-        bestCol = COLS / 2;
+// Root moves of one iterative-deepening pass, searched in parallel. The threads
+// share the best score so far as alpha; a move whose score beat the alpha its
+// search started with has an exact score.
+struct RootSearch2D {
+    struct Position2D position;
+    int depth;
+    int columns[COLS];
+    int scores[COLS];
+    bool exact[COLS];
+    atomic_int alpha;
+};
+
+static void searchRootMove2D(void *context, int index) {
+    struct RootSearch2D *root = context;
+    struct Position2D child = root->position;
+    play2D(&child, root->columns[index]);
+
+    int alpha = atomic_load_explicit(&root->alpha, memory_order_relaxed);
+    // The player replies next, so the minimizing side; an AI win is seen there at once
+    int score = minimax2D(child, root->depth - 1, alpha, INT_MAX, false);
+    root->scores[index] = score;
+    root->exact[index] = score > alpha;
+    while (score > alpha && !atomic_compare_exchange_weak(&root->alpha, &alpha, score)) {
     }
+}
 
-    for (int c = 0; c < COLS; c++) {
-        if (isValidMove2D(c)) {
-            // Check for immediate AI win
-            makeMove2D(c, AI);
-            if (winningMove2D(AI)) {
-                undoMove2D(c);
-                return c; // Immediate win is the best move
-            }
-            undoMove2D(c);
-
-            // Evaluate the move using minimax
-            makeMove2D(c, AI);
-            // We call minimax for the minimizing player (false) because it's evaluating the state *after* AI moves,
-            // anticipating the player's response.
-            int score = minimax2D(difficulty, INT_MIN, INT_MAX, false);
-            undoMove2D(c);
-
-            // Update best move found so far
-            if (bestCol == -1 || score > bestScore) { // If it's the first valid move checked OR score is better
-                bestScore = score;
-                bestCol = c;
-            }
+// Moves order[index] to the front; the columns before it shift back one and
+// keep their order
+static void moveToFront2D(int *order, int index) {
+    int col = order[index];
+    for (int k = index; k > 0; k--) order[k] = order[k - 1];
+    order[0] = col;
+}
+
+// Iterative deepening: one ply deeper each pass, the previous pass's best column
+// searched first so the others meet a tight alpha, until the think time runs out.
+int getBestMove2D() {
+    int timeMs = thinkTimeMs;
+
+    if (thinkTimeMs == THINK_TIME_PERFECT) {
+        int score;
+        int col = solveMove2D(&position, SOLVER_TIME_MS, &score);
+        if (col != -1) {
+            // A win with the AI's k-th stone scores 22 - k
+            int stones = C4_CELLS / 2 + 1 - (score < 0 ? -score : score);
+            if (score > 0) snprintf(solverNote, sizeof(solverNote), "Solved: AI wins with its stone %d", stones);
+            else if (score < 0) snprintf(solverNote, sizeof(solverNote), "Solved: you can win with your stone %d", stones);
+            else strcpy(solverNote, "Solved: draw with best play");
+            return col;
         }
+        strcpy(solverNote, "Not solved in time, searching");
+        timeMs = SOLVER_FALLBACK_TIME_MS;
     }
 
-    // If no move was found (should only happen if board is full at start, which is impossible)
-    // or if all moves lead to immediate loss (minimax returns very low scores),
-    // pick the first valid one found initially or during the loop.
-    // If bestCol is still -1 after the loop, find the first available column as a fallback.
-    if (bestCol == -1) {
-        for (int c = 0; c < COLS; c++) {
-            if (isValidMove2D(c)) {
-                bestCol = c;
-                break;
-            }
+    struct RootSearch2D root = {.position = position};
+    int *order = root.columns;
+    int moveCount = 0;
+    for (int i = 0; i < COLS; i++) {
+        if (isValidMove2D(centerOrder2D[i])) order[moveCount++] = centerOrder2D[i];
+    }
+    if (moveCount <= 1) return (moveCount == 1) ? order[0] : -1;
+
+    timespec_get(&searchDeadline, TIME_UTC);
+    searchDeadline.tv_sec += timeMs / 1000;
+    searchDeadline.tv_nsec += (long)(timeMs % 1000) * 1000000L;
+    if (searchDeadline.tv_nsec >= 1000000000L) {
+        searchDeadline.tv_sec++;
+        searchDeadline.tv_nsec -= 1000000000L;
+    }
+    atomic_store(&searchAborted, false);
+
+    int bestCol = order[0];
+    for (int depth = 1; depth <= C4_CELLS - position.moves; depth++) {
+        root.depth = depth;
+        atomic_store(&root.alpha, INT_MIN);
+        runParallel(moveCount, searchRootMove2D, &root);
+        if (searchAborted) break; // Keep the last finished pass's move
+
+        int best = -1; // Ties go to the move searched first
+        for (int i = 0; i < moveCount; i++) {
+            if (root.exact[i] && (best == -1 || root.scores[i] > root.scores[best])) best = i;
         }
+        int alpha = root.scores[best];
+        bestCol = order[best];
+        moveToFront2D(order, best);
+        if (alpha >= WIN_SCORE || alpha <= -WIN_SCORE) break; // Forced result, deeper passes can't change it
     }
-
     return bestCol;
 }
 
 bool isFull2D() {
-    for (int c = 0; c < COLS; c++)
-        if (board[0][c] == EMPTY)
-            return false;
-    return true;
+    return position.moves == C4_CELLS;
 }
 
 // ----------------------- RAYLIB DRAWING FUNCTIONS -----------------------
@@ -214,22 +297,26 @@ void drawDifficultySelection() {
     Rectangle easyButton = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 30, 200, 50 };
     Rectangle mediumButton = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 30, 200, 50 };
     Rectangle hardButton = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 90, 200, 50 };
+    Rectangle perfectButton = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 150, 200, 50 };
 
     // Draw buttons
     DrawRectangleRec(easyButton, LIGHTGRAY);
     DrawRectangleRec(mediumButton, LIGHTGRAY);
     DrawRectangleRec(hardButton, LIGHTGRAY);
+    DrawRectangleRec(perfectButton, LIGHTGRAY);
 
     // Draw button text
-    DrawText("Easy (1)", easyButton.x + easyButton.width / 2 - MeasureText("Easy (1)", 20) / 2, easyButton.y + easyButton.height / 2 - 10, 20, BLACK);
-    DrawText("Medium (2)", mediumButton.x + mediumButton.width / 2 - MeasureText("Medium (2)", 20) / 2, mediumButton.y + mediumButton.height / 2 - 10, 20, BLACK);
-    DrawText("Hard (3)", hardButton.x + hardButton.width / 2 - MeasureText("Hard (3)", 20) / 2, hardButton.y + hardButton.height / 2 - 10, 20, BLACK);
+    DrawText("Easy (0.05 s)", easyButton.x + easyButton.width / 2 - MeasureText("Easy (0.05 s)", 20) / 2, easyButton.y + easyButton.height / 2 - 10, 20, BLACK);
+    DrawText("Medium (0.5 s)", mediumButton.x + mediumButton.width / 2 - MeasureText("Medium (0.5 s)", 20) / 2, mediumButton.y + mediumButton.height / 2 - 10, 20, BLACK);
+    DrawText("Hard (2 s)", hardButton.x + hardButton.width / 2 - MeasureText("Hard (2 s)", 20) / 2, hardButton.y + hardButton.height / 2 - 10, 20, BLACK);
+    DrawText("Perfect (5 s)", perfectButton.x + perfectButton.width / 2 - MeasureText("Perfect (5 s)", 20) / 2, perfectButton.y + perfectButton.height / 2 - 10, 20, BLACK);
 
     // Add hover effect (optional)
     Vector2 mousePoint = GetMousePosition();
     if (CheckCollisionPointRec(mousePoint, easyButton)) DrawRectangleLinesEx(easyButton, 2, DARKGRAY);
     if (CheckCollisionPointRec(mousePoint, mediumButton)) DrawRectangleLinesEx(mediumButton, 2, DARKGRAY);
     if (CheckCollisionPointRec(mousePoint, hardButton)) DrawRectangleLinesEx(hardButton, 2, DARKGRAY);
+    if (CheckCollisionPointRec(mousePoint, perfectButton)) DrawRectangleLinesEx(perfectButton, 2, DARKGRAY);
 }
 
 void drawBoardRaylib(const char* message, GameState currentState) { // Added currentState parameter
@@ -246,9 +333,10 @@ void drawBoardRaylib(const char* message, GameState currentState) { // Added cur
                 DrawCircle(x + CELL_SIZE / 2, y + CELL_SIZE / 2, PIECE_RADIUS, LIGHTGRAY);
 
                 // Draw pieces
-                if (board[r][c] == PLAYER) {
+                int piece = pieceAt2D(r, c);
+                if (piece == PLAYER) {
                     DrawCircle(x + CELL_SIZE / 2, y + CELL_SIZE / 2, PIECE_RADIUS, RED);
-                } else if (board[r][c] == AI) {
+                } else if (piece == AI) {
                     DrawCircle(x + CELL_SIZE / 2, y + CELL_SIZE / 2, PIECE_RADIUS, YELLOW);
                 }
                  // Draw grid lines
@@ -257,6 +345,7 @@ void drawBoardRaylib(const char* message, GameState currentState) { // Added cur
         }
         // Display game message (whose turn, win/loss/draw)
         DrawText(message, 10, 10, 40, BLACK);
+        if (thinkTimeMs == THINK_TIME_PERFECT) DrawText(solverNote, 10, 60, 20, DARKGRAY);
     } else {
         // If in difficulty selection state, call its specific drawing function
         drawDifficultySelection();
@@ -265,23 +354,56 @@ void drawBoardRaylib(const char* message, GameState currentState) { // Added cur
 
 // Function to reset the game state
 void resetGame() {
-    memset(board, EMPTY, sizeof(board));
+    position = (struct Position2D){0};
     currentState = DIFFICULTY_SELECTION;
     gameOver = false;
     winner = EMPTY;
     strcpy(message, "Select Difficulty");
+    solverNote[0] = '\0';
     // Difficulty is not reset here, keeps the last selected value.
 }
 
 // ----------------------- MAIN -----------------------
 
-int main() {
+// `twoDConnectFour.exe check`: moves each root column to the front from every
+// place in the center-first order and checks the order stays a permutation of
+// the columns; exits non-zero on a failure
+static int runOrderCheck2D() {
+    int failures = 0;
+    for (int index = 0; index < COLS; index++) {
+        int order[COLS], seen[COLS] = {0};
+        memcpy(order, centerOrder2D, sizeof(order));
+        moveToFront2D(order, index);
+        bool ok = order[0] == centerOrder2D[index];
+        for (int i = 0; i < COLS; i++) {
+            if (order[i] < 0 || order[i] >= COLS || seen[order[i]]++) ok = false;
+        }
+        for (int i = 0, k = 1; i < COLS; i++) { // The others keep their order
+            if (i == index) continue;
+            if (order[k++] != centerOrder2D[i]) ok = false;
+        }
+        if (!ok) {
+            printf("FAIL: moving column %d to the front gives", centerOrder2D[index]);
+            for (int i = 0; i < COLS; i++) printf(" %d", order[i]);
+            printf("\n");
+            failures++;
+        }
+    }
+    printf("%s\n", failures ? "Column order check failed" : "Column order check passed");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "check") == 0) return runOrderCheck2D();
+
     // Initialization
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "2D Connect Four - Raylib");
     SetTargetFPS(60);
 
     // Initialize game state (now uses global variables)
     resetGame(); // Initialize state using reset function
+    // Opening book for the perfect mode; without one the solver searches from the first move
+    if (!openBook2D(BOOK_DEFAULT_FILE)) printf("No opening book (%s); build one with connectFourBook\n", BOOK_DEFAULT_FILE);
 
     // Main game loop
     while (!WindowShouldClose()) {
@@ -293,17 +415,22 @@ int main() {
                 Rectangle easyButton = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 30, 200, 50 };
                 Rectangle mediumButton = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 30, 200, 50 };
                 Rectangle hardButton = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 90, 200, 50 };
+                Rectangle perfectButton = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 150, 200, 50 };
 
                 if (CheckCollisionPointRec(mousePoint, easyButton)) {
-                    difficulty = 2; // Easy
+                    thinkTimeMs = THINK_TIME_EASY_MS;
                     currentState = PLAYER_TURN;
                     strcpy(message, "Player's Turn (Click Column)");
                 } else if (CheckCollisionPointRec(mousePoint, mediumButton)) {
-                    difficulty = 4; // Medium
+                    thinkTimeMs = THINK_TIME_MEDIUM_MS;
                     currentState = PLAYER_TURN;
                     strcpy(message, "Player's Turn (Click Column)");
                 } else if (CheckCollisionPointRec(mousePoint, hardButton)) {
-                    difficulty = 6; // Hard
+                    thinkTimeMs = THINK_TIME_HARD_MS;
+                    currentState = PLAYER_TURN;
+                    strcpy(message, "Player's Turn (Click Column)");
+                } else if (CheckCollisionPointRec(mousePoint, perfectButton)) {
+                    thinkTimeMs = THINK_TIME_PERFECT;
                     currentState = PLAYER_TURN;
                     strcpy(message, "Player's Turn (Click Column)");
                 }
@@ -319,7 +446,7 @@ int main() {
                         int col = (mouseX - BOARD_OFFSET_X) / CELL_SIZE;
 
                         if (isValidMove2D(col)) {
-                            makeMove2D(col, PLAYER);
+                            makeMove2D(col);
                             if (winningMove2D(PLAYER)) {
                                 gameOver = true;
                                 winner = PLAYER;
@@ -352,7 +479,7 @@ int main() {
 
                 int aiCol = getBestMove2D();
                  if (aiCol != -1) { // Ensure a valid move was found
-                    makeMove2D(aiCol, AI);
+                    makeMove2D(aiCol);
                     if (winningMove2D(AI)) {
                         gameOver = true;
                         winner = AI;
@@ -407,6 +534,7 @@ int main() {
     }
 
     // De-Initialization
+    closeBook2D();
     CloseWindow();
 
     return 0;